@@ -0,0 +1,412 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Synthetic xdg-shell client driving dwl-bench, see bench/run.sh. Maps
+ * windows across all tags, then switches tags, cycles the layouts (which
+ * moves and resizes every tiled window) and toggles fullscreen, waiting for
+ * a frame after every step. Its own timings are printed as JSON lines. */
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+#include "dwl-ipc-unstable-v2-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
+
+#define LENGTH(X)               (sizeof X / sizeof X[0])
+#define MAXSAMPLES              65536
+#define TIMEOUT                 10000 /* ms to wait for a frame */
+
+typedef struct {
+	struct wl_surface *surface;
+	struct xdg_surface *xdg;
+	struct xdg_toplevel *toplevel;
+	int width, height; /* from the last toplevel configure */
+	int configured, framed;
+} Window;
+
+typedef struct {
+	const char *name;
+	unsigned long n;
+	double sum, max;
+	float samples[MAXSAMPLES];
+} Stat;
+
+enum { MapFrame, TagFrame, LayoutFrame, FullscreenFrame, StatLast };
+
+static void die(const char *fmt, ...);
+static void draw(Window *w);
+static void frame(Window *w);
+static void framedone(void *data, struct wl_callback *cb, uint32_t time);
+static void globaladd(void *data, struct wl_registry *reg, uint32_t name,
+		const char *interface, uint32_t version);
+static void globalremove(void *data, struct wl_registry *reg, uint32_t name);
+static void ipclayout(void *data, struct zdwl_ipc_manager_v2 *mgr, const char *name);
+static void ipctags(void *data, struct zdwl_ipc_manager_v2 *mgr, uint32_t amount);
+static void mapwindow(Window *w, int i);
+static void ping(void *data, struct xdg_wm_base *base, uint32_t serial);
+static void record(int stat, const struct timespec *start);
+static void report(void);
+static void surfaceconfigure(void *data, struct xdg_surface *xdg, uint32_t serial);
+static void toplevelclose(void *data, struct xdg_toplevel *toplevel);
+static void toplevelconfigure(void *data, struct xdg_toplevel *toplevel,
+		int32_t width, int32_t height, struct wl_array *states);
+static void waitframe(Window *w);
+
+static struct wl_display *dpy;
+static struct wl_compositor *compositor;
+static struct wl_shm *shm;
+static struct xdg_wm_base *wmbase;
+static struct wl_output *output;
+static struct zdwl_ipc_manager_v2 *ipc;
+static struct zdwl_ipc_output_v2 *ipcout;
+static unsigned int ntags, nlayouts;
+static Window *windows;
+static int nwindows = 100;
+static Stat stats[StatLast] = {
+	[MapFrame] = { .name = "client_map_to_frame" },
+	[TagFrame] = { .name = "client_tag_switch" },
+	[LayoutFrame] = { .name = "client_layout_switch" },
+	[FullscreenFrame] = { .name = "client_fullscreen" },
+};
+
+static const struct wl_callback_listener frame_listener = { .done = framedone };
+static const struct wl_registry_listener registry_listener = {
+	.global = globaladd,
+	.global_remove = globalremove,
+};
+static const struct zdwl_ipc_manager_v2_listener ipc_listener = {
+	.tags = ipctags,
+	.layout = ipclayout,
+};
+static const struct xdg_wm_base_listener wmbase_listener = { .ping = ping };
+static const struct xdg_surface_listener surface_listener = { .configure = surfaceconfigure };
+static const struct xdg_toplevel_listener toplevel_listener = {
+	.configure = toplevelconfigure,
+	.close = toplevelclose,
+};
+
+void
+die(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	fputs("bench-client: ", stderr);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	if (fmt[0] && fmt[strlen(fmt) - 1] == ':')
+		fprintf(stderr, " %s", strerror(errno));
+	fputc('\n', stderr);
+	exit(1);
+}
+
+void
+draw(Window *w)
+{
+	/* Attach a fresh buffer of the configured size */
+	char path[4096];
+	int width = w->width ? w->width : 640, height = w->height ? w->height : 480;
+	int fd, stride = width * 4, size = stride * height;
+	struct wl_shm_pool *pool;
+	struct wl_buffer *buf;
+	void *data;
+
+	snprintf(path, sizeof(path), "%s/dwl-bench-XXXXXX", getenv("XDG_RUNTIME_DIR"));
+	if ((fd = mkstemp(path)) < 0)
+		die("mkstemp:");
+	unlink(path);
+	if (ftruncate(fd, size) < 0)
+		die("ftruncate:");
+	if ((data = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+		die("mmap:");
+	memset(data, 0x40, (size_t)size);
+	munmap(data, (size_t)size);
+
+	pool = wl_shm_create_pool(shm, fd, size);
+	buf = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_XRGB8888);
+	wl_shm_pool_destroy(pool);
+	close(fd);
+
+	wl_surface_attach(w->surface, buf, 0, 0);
+	wl_surface_damage(w->surface, 0, 0, width, height);
+	/* the compositor keeps its own reference until it is done with it */
+	wl_buffer_destroy(buf);
+}
+
+void
+frame(Window *w)
+{
+	/* Ask for a frame callback on the next commit */
+	w->framed = 0;
+	wl_callback_add_listener(wl_surface_frame(w->surface), &frame_listener, w);
+}
+
+void
+framedone(void *data, struct wl_callback *cb, uint32_t time)
+{
+	Window *w = data;
+	w->framed = 1;
+	wl_callback_destroy(cb);
+}
+
+void
+globaladd(void *data, struct wl_registry *reg, uint32_t name,
+		const char *interface, uint32_t version)
+{
+	if (!strcmp(interface, wl_compositor_interface.name))
+		compositor = wl_registry_bind(reg, name, &wl_compositor_interface, 1);
+	else if (!strcmp(interface, wl_shm_interface.name))
+		shm = wl_registry_bind(reg, name, &wl_shm_interface, 1);
+	else if (!strcmp(interface, xdg_wm_base_interface.name))
+		wmbase = wl_registry_bind(reg, name, &xdg_wm_base_interface, 1);
+	else if (!strcmp(interface, wl_output_interface.name) && !output)
+		output = wl_registry_bind(reg, name, &wl_output_interface, 1);
+	else if (!strcmp(interface, zdwl_ipc_manager_v2_interface.name))
+		ipc = wl_registry_bind(reg, name, &zdwl_ipc_manager_v2_interface, 1);
+}
+
+void
+globalremove(void *data, struct wl_registry *reg, uint32_t name)
+{
+}
+
+void
+ipclayout(void *data, struct zdwl_ipc_manager_v2 *mgr, const char *name)
+{
+	nlayouts++;
+}
+
+void
+ipctags(void *data, struct zdwl_ipc_manager_v2 *mgr, uint32_t amount)
+{
+	ntags = amount;
+}
+
+void
+mapwindow(Window *w, int i)
+{
+	char title[32];
+	struct timespec start;
+
+	w->surface = wl_compositor_create_surface(compositor);
+	w->xdg = xdg_wm_base_get_xdg_surface(wmbase, w->surface);
+	w->toplevel = xdg_surface_get_toplevel(w->xdg);
+	xdg_surface_add_listener(w->xdg, &surface_listener, w);
+	xdg_toplevel_add_listener(w->toplevel, &toplevel_listener, w);
+	snprintf(title, sizeof(title), "bench %d", i);
+	xdg_toplevel_set_title(w->toplevel, title);
+	xdg_toplevel_set_app_id(w->toplevel, "dwl-bench");
+	wl_surface_commit(w->surface);
+
+	while (!w->configured)
+		if (wl_display_dispatch(dpy) < 0)
+			die("dispatch failed");
+
+	/* surfaceconfigure() attached the first buffer, this commit maps it */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	frame(w);
+	wl_surface_commit(w->surface);
+	waitframe(w);
+	record(MapFrame, &start);
+
+	/* new windows get focus, spread them across the tags */
+	zdwl_ipc_output_v2_set_client_tags(ipcout, 0, 1u << (i % ntags));
+}
+
+void
+ping(void *data, struct xdg_wm_base *base, uint32_t serial)
+{
+	xdg_wm_base_pong(base, serial);
+}
+
+void
+record(int stat, const struct timespec *start)
+{
+	Stat *s = &stats[stat];
+	struct timespec now;
+	double us;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	us = (double)(now.tv_sec - start->tv_sec) * 1e6
+			+ (double)(now.tv_nsec - start->tv_nsec) / 1e3;
+	if (s->n < MAXSAMPLES)
+		s->samples[s->n] = (float)us;
+	s->n++;
+	s->sum += us;
+	if (us > s->max)
+		s->max = us;
+}
+
+static int
+cmpfloat(const void *a, const void *b)
+{
+	float x = *(const float *)a, y = *(const float *)b;
+	return (x > y) - (x < y);
+}
+
+void
+report(void)
+{
+	unsigned long n;
+	Stat *s;
+
+	for (s = stats; s < stats + LENGTH(stats); s++) {
+		n = s->n < MAXSAMPLES ? s->n : MAXSAMPLES;
+		qsort(s->samples, n, sizeof(*s->samples), cmpfloat);
+		printf("{\"metric\":\"%s\",\"unit\":\"us\",\"n\":%lu,\"mean\":%.1f,"
+				"\"p50\":%.1f,\"p99\":%.1f,\"max\":%.1f}\n", s->name, s->n,
+				s->n ? s->sum / (double)s->n : 0.0,
+				n ? s->samples[n / 2] : 0.0, n ? s->samples[n * 99 / 100] : 0.0,
+				s->max);
+	}
+	printf("{\"metric\":\"windows\",\"unit\":\"count\",\"n\":%d}\n", nwindows);
+}
+
+void
+surfaceconfigure(void *data, struct xdg_surface *xdg, uint32_t serial)
+{
+	Window *w = data;
+
+	xdg_surface_ack_configure(xdg, serial);
+	draw(w);
+	/* the first buffer is committed by mapwindow() to time the map */
+	if (w->configured)
+		wl_surface_commit(w->surface);
+	w->configured = 1;
+}
+
+void
+toplevelclose(void *data, struct xdg_toplevel *toplevel)
+{
+}
+
+void
+toplevelconfigure(void *data, struct xdg_toplevel *toplevel,
+		int32_t width, int32_t height, struct wl_array *states)
+{
+	Window *w = data;
+	w->width = width;
+	w->height = height;
+}
+
+void
+waitframe(Window *w)
+{
+	/* Dispatch until the frame callback requested on w fired */
+	struct pollfd pfd = { .fd = wl_display_get_fd(dpy), .events = POLLIN };
+
+	while (!w->framed) {
+		while (wl_display_prepare_read(dpy) < 0)
+			if (wl_display_dispatch_pending(dpy) < 0)
+				die("dispatch failed");
+		if (w->framed) {
+			wl_display_cancel_read(dpy);
+			break;
+		}
+		wl_display_flush(dpy);
+		if (poll(&pfd, 1, TIMEOUT) <= 0) {
+			wl_display_cancel_read(dpy);
+			die("no frame within %d ms", TIMEOUT);
+		}
+		if (wl_display_read_events(dpy) < 0 || wl_display_dispatch_pending(dpy) < 0)
+			die("dispatch failed");
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct wl_registry *reg;
+	struct timespec start;
+	unsigned int t, l;
+	int c, i, r, rounds = 3;
+
+	while ((c = getopt(argc, argv, "n:r:")) != -1) {
+		if (c == 'n')
+			nwindows = atoi(optarg);
+		else if (c == 'r')
+			rounds = atoi(optarg);
+		else
+			die("usage: %s [-n windows] [-r rounds]", argv[0]);
+	}
+	if (nwindows < 1)
+		die("need at least one window");
+
+	if (!(dpy = wl_display_connect(NULL)))
+		die("cannot connect to the compositor");
+	reg = wl_display_get_registry(dpy);
+	wl_registry_add_listener(reg, &registry_listener, NULL);
+	wl_display_roundtrip(dpy);
+	if (!compositor || !shm || !wmbase || !output || !ipc)
+		die("compositor lacks a required global");
+	xdg_wm_base_add_listener(wmbase, &wmbase_listener, NULL);
+	zdwl_ipc_manager_v2_add_listener(ipc, &ipc_listener, NULL);
+	ipcout = zdwl_ipc_manager_v2_get_output(ipc, output);
+	wl_display_roundtrip(dpy);
+	if (!ntags)
+		die("no tags announced");
+
+	windows = calloc((size_t)nwindows, sizeof(*windows));
+	if (!windows)
+		die("calloc:");
+	for (i = 0; i < nwindows; i++)
+		mapwindow(&windows[i], i);
+
+	/* window t is the first one on tag t */
+	for (r = 0; r < rounds; r++) {
+		for (t = 0; t < ntags && t < (unsigned int)nwindows; t++) {
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			zdwl_ipc_output_v2_set_tags(ipcout, 1u << t, 0);
+			frame(&windows[t]);
+			wl_surface_commit(windows[t].surface);
+			waitframe(&windows[t]);
+			record(TagFrame, &start);
+		}
+	}
+
+	zdwl_ipc_output_v2_set_tags(ipcout, 1, 0);
+	for (r = 0; r < rounds; r++) {
+		for (l = 0; l < nlayouts; l++) {
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			zdwl_ipc_output_v2_set_layout(ipcout, l);
+			frame(&windows[0]);
+			wl_surface_commit(windows[0].surface);
+			waitframe(&windows[0]);
+			record(LayoutFrame, &start);
+		}
+	}
+	zdwl_ipc_output_v2_set_layout(ipcout, 0);
+
+	/* windows on tag 1 */
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < nwindows; i += (int)ntags) {
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			xdg_toplevel_set_fullscreen(windows[i].toplevel, NULL);
+			frame(&windows[i]);
+			wl_surface_commit(windows[i].surface);
+			waitframe(&windows[i]);
+			xdg_toplevel_unset_fullscreen(windows[i].toplevel);
+			frame(&windows[i]);
+			wl_surface_commit(windows[i].surface);
+			waitframe(&windows[i]);
+			record(FullscreenFrame, &start);
+		}
+	}
+
+	for (i = 0; i < nwindows; i++) {
+		xdg_toplevel_destroy(windows[i].toplevel);
+		xdg_surface_destroy(windows[i].xdg);
+		wl_surface_destroy(windows[i].surface);
+	}
+	wl_display_roundtrip(dpy);
+	free(windows);
+	report();
+	wl_display_disconnect(dpy);
+	return 0;
+}
@@ -0,0 +1,151 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Benchmark and regression test of the layouts in layout.c: every layout is
+ * run for 1 to -n windows with and without gaps and checked for boxes
+ * leaving the monitor, negative sizes, overlaps and uncovered pixels.
+ * Timings are printed as JSON lines, the exit status is the number of
+ * failed layouts. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <wlr/util/box.h>
+
+#include "../layout.h"
+
+#define LENGTH(X)               (sizeof X / sizeof X[0])
+#define MAXOVERLAP              64 /* check overlaps up to this many windows */
+
+typedef struct {
+	const char *name;
+	LayoutFunc fn;
+	int stacked; /* windows may overlap */
+} Layout;
+
+static const Layout layouts[] = {
+	{ "tile",        tilegeom,        0 },
+	{ "monocle",     monoclegeom,     1 },
+	{ "deck",        deckgeom,        1 },
+	{ "bstack",      bstackgeom,      0 },
+	{ "bstackhoriz", bstackhorizgeom, 0 },
+	{ "gaplessgrid", gaplessgridgeom, 0 },
+};
+
+static const LayoutParams params[] = {
+	/* area                    oh  ov  ih  iv  smartgaps mfact  nmaster */
+	{ { 10, 30, 1910, 1050 },  0,  0,  0,  0,  1,        0.55f, 1 },
+	{ { 0, 0, 1080, 1920 },    0,  0,  0,  0,  1,        0.5f,  3 },
+	{ { 0, 0, 3440, 1440 },    0,  0,  0,  0,  1,        0.6f,  0 },
+	{ { 10, 30, 1910, 1050 },  10, 10, 10, 10, 1,        0.55f, 1 },
+	{ { 0, 0, 2560, 1440 },    5,  20, 8,  3,  0,        0.45f, 2 },
+};
+
+static int
+check(const Layout *l, const LayoutParams *p, int n, const struct wlr_box *b)
+{
+	/* Returns 0 if the boxes are sane, prints the first problem otherwise */
+	const struct wlr_box *a = &p->area;
+	int gaps = p->gappoh || p->gappov || p->gappih || p->gappiv;
+	long covered = 0;
+	int i, j;
+
+	/* with gaps, windows run out of space long before 10000 */
+	if (gaps && n > MAXOVERLAP)
+		return 0;
+
+	for (i = 0; i < n; i++) {
+		if (b[i].width < 0 || b[i].height < 0) {
+			fprintf(stderr, "%s: n=%d: window %d has negative size %dx%d\n",
+					l->name, n, i, b[i].width, b[i].height);
+			return 1;
+		}
+		if (b[i].x < a->x || b[i].y < a->y || b[i].x + b[i].width > a->x + a->width
+				|| b[i].y + b[i].height > a->y + a->height) {
+			fprintf(stderr, "%s: n=%d: window %d at %d,%d %dx%d leaves the monitor\n",
+					l->name, n, i, b[i].x, b[i].y, b[i].width, b[i].height);
+			return 1;
+		}
+		covered += (long)b[i].width * b[i].height;
+	}
+	if (l->stacked)
+		return 0;
+
+	for (i = 0; n <= MAXOVERLAP && i < n; i++) {
+		for (j = i + 1; j < n; j++) {
+			if (b[i].x < b[j].x + b[j].width && b[j].x < b[i].x + b[i].width
+					&& b[i].y < b[j].y + b[j].height && b[j].y < b[i].y + b[i].height) {
+				fprintf(stderr, "%s: n=%d: windows %d and %d overlap\n", l->name, n, i, j);
+				return 1;
+			}
+		}
+	}
+	/* without gaps (and overlaps) the windows cover the whole monitor */
+	if (!gaps && covered != (long)a->width * a->height) {
+		fprintf(stderr, "%s: n=%d: %ld of %ld pixels covered\n", l->name, n,
+				covered, (long)a->width * a->height);
+		return 1;
+	}
+	return 0;
+}
+
+static double
+now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+int
+main(int argc, char *argv[])
+{
+	const Layout *l;
+	const LayoutParams *p;
+	struct wlr_box *boxes;
+	double start, ns;
+	static const int steps[] = { 1, 2, 5 };
+	int c, n, r, reps, scale, failed, nfailed = 0, maxn = 10000;
+	size_t k;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		if (c == 'n')
+			maxn = atoi(optarg);
+		else
+			goto usage;
+	}
+	if (optind < argc || maxn < 1)
+		goto usage;
+	if (!(boxes = calloc((size_t)maxn, sizeof(*boxes))))
+		return 1;
+
+	for (l = layouts; l < layouts + LENGTH(layouts); l++) {
+		failed = 0;
+		for (p = params; p < params + LENGTH(params); p++) {
+			for (n = 1; n <= maxn && !failed; n++) {
+				l->fn(p, n, boxes);
+				failed = check(l, p, n, boxes);
+			}
+		}
+		nfailed += failed;
+
+		/* time 1, 2, 5, 10, 20, 50, ... windows with the first params */
+		for (scale = 1; scale <= maxn; scale *= 10) {
+			for (k = 0; k < LENGTH(steps) && (n = steps[k] * scale) <= maxn; k++) {
+				reps = 100000 / n + 1;
+				start = now();
+				for (r = 0; r < reps; r++)
+					l->fn(params, n, boxes);
+				ns = (now() - start) / reps;
+				printf("{\"layout\":\"%s\",\"windows\":%d,\"ns\":%.1f,\"ns_per_window\":%.2f}\n",
+						l->name, n, ns, ns / n);
+			}
+		}
+		printf("{\"layout\":\"%s\",\"ok\":%s}\n", l->name, failed ? "false" : "true");
+	}
+	free(boxes);
+	return nfailed;
+
+usage:
+	fprintf(stderr, "usage: %s [-n windows]\n", argv[0]);
+	return 1;
+}
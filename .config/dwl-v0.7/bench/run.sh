@@ -0,0 +1,28 @@
+#!/bin/sh
+# Headless benchmark: runs dwl-bench on the wlroots headless backend with the
+# pixman renderer (no GPU, no seat needed) and drives it with bench/client.
+# Results of both are appended as JSON lines to $BENCH_OUT.
+#
+# usage: bench/run.sh [windows] [rounds]
+set -e
+cd "$(dirname "$0")/.."
+
+windows=${1:-100}
+rounds=${2:-3}
+out=${BENCH_OUT:-bench/results.json}
+case $out in /*) ;; *) out=$PWD/$out ;; esac
+runtime=$(mktemp -d)
+trap 'rm -rf "$runtime"' EXIT INT TERM
+: > "$out"
+
+env -u WAYLAND_DISPLAY -u DISPLAY \
+	XDG_RUNTIME_DIR="$runtime" \
+	WLR_BACKENDS=headless \
+	WLR_RENDERER=pixman \
+	WLR_HEADLESS_OUTPUTS=1 \
+	WLR_LIBINPUT_NO_DEVICES=1 \
+	DWL_BENCH_OUT="$out" \
+	./dwl-bench -s "./bench/client -n $windows -r $rounds >>'$out'; kill \$PPID" \
+	</dev/null >/dev/null
+
+cat "$out"
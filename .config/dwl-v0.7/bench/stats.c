@@ -0,0 +1,184 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Timings collected by dwl-bench, see bench/run.sh. Reported as JSON lines
+ * to $DWL_BENCH_OUT (or stderr) when the compositor exits. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+#define LENGTH(X)               (sizeof X / sizeof X[0])
+#define MAXSAMPLES              65536
+#define MAXPENDING              1024
+
+typedef struct {
+	const char *name;
+	unsigned long n;
+	double sum, max;
+	float samples[MAXSAMPLES]; /* the first MAXSAMPLES, in us */
+	struct timespec start;
+} Stat;
+
+static Stat stats[BenchLast] = {
+	[BenchArrange] = { .name = "arrange" },
+	[BenchCommit] = { .name = "commit" },
+	[BenchMapFrame] = { .name = "map_to_frame" },
+};
+
+/* surfaces mapped but not shown yet, keyed by their monitor */
+static struct {
+	const void *key;
+	struct timespec start;
+} pending[MAXPENDING];
+static size_t npending;
+
+/* allocations by dwl and everything it links, see malloc() below */
+static unsigned long nallocs, nfrees;
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+static void
+record(Stat *s, const struct timespec *start)
+{
+	struct timespec now;
+	double us;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	us = (double)(now.tv_sec - start->tv_sec) * 1e6
+			+ (double)(now.tv_nsec - start->tv_nsec) / 1e3;
+	if (s->n < MAXSAMPLES)
+		s->samples[s->n] = (float)us;
+	s->n++;
+	s->sum += us;
+	if (us > s->max)
+		s->max = us;
+}
+
+static int
+cmpfloat(const void *a, const void *b)
+{
+	float x = *(const float *)a, y = *(const float *)b;
+	return (x > y) - (x < y);
+}
+
+static long
+procstatus(const char *field)
+{
+	/* Read a kB value from /proc/self/status */
+	char line[256];
+	long v = -1;
+	size_t len = strlen(field);
+	FILE *f = fopen("/proc/self/status", "r");
+
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (!strncmp(line, field, len) && line[len] == ':') {
+			v = strtol(line + len + 1, NULL, 10);
+			break;
+		}
+	}
+	fclose(f);
+	return v;
+}
+
+void
+benchframe(const void *key)
+{
+	/* A frame was committed for key, every surface waiting for it is on
+	 * screen now */
+	size_t i = 0;
+
+	while (i < npending) {
+		if (pending[i].key != key) {
+			i++;
+			continue;
+		}
+		record(&stats[BenchMapFrame], &pending[i].start);
+		pending[i] = pending[--npending];
+	}
+}
+
+void
+benchmapped(const void *key)
+{
+	if (!key || npending == MAXPENDING)
+		return;
+	pending[npending].key = key;
+	clock_gettime(CLOCK_MONOTONIC, &pending[npending++].start);
+}
+
+void
+benchreport(void)
+{
+	const char *path = getenv("DWL_BENCH_OUT");
+	FILE *out = path ? fopen(path, "a") : NULL;
+	unsigned long n;
+	Stat *s;
+
+	if (!out)
+		out = stderr;
+	for (s = stats; s < stats + LENGTH(stats); s++) {
+		n = s->n < MAXSAMPLES ? s->n : MAXSAMPLES;
+		qsort(s->samples, n, sizeof(*s->samples), cmpfloat);
+		fprintf(out, "{\"metric\":\"%s\",\"unit\":\"us\",\"n\":%lu,\"mean\":%.1f,"
+				"\"p50\":%.1f,\"p99\":%.1f,\"max\":%.1f}\n", s->name, s->n,
+				s->n ? s->sum / (double)s->n : 0.0,
+				n ? s->samples[n / 2] : 0.0, n ? s->samples[n * 99 / 100] : 0.0,
+				s->max);
+	}
+	fprintf(out, "{\"metric\":\"rss\",\"unit\":\"kB\",\"current\":%ld,\"peak\":%ld}\n",
+			procstatus("VmRSS"), procstatus("VmHWM"));
+	fprintf(out, "{\"metric\":\"allocs\",\"unit\":\"count\",\"allocs\":%lu,\"frees\":%lu}\n",
+			nallocs, nfrees);
+	if (out != stderr)
+		fclose(out);
+}
+
+void
+benchstart(int metric)
+{
+	clock_gettime(CLOCK_MONOTONIC, &stats[metric].start);
+}
+
+void
+benchstop(int metric)
+{
+	record(&stats[metric], &stats[metric].start);
+}
+
+/* Defining these in the executable interposes them for the shared libraries
+ * as well, glibc exports the real allocator under __libc_*(). */
+void *
+malloc(size_t size)
+{
+	__atomic_fetch_add(&nallocs, 1, __ATOMIC_RELAXED);
+	return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+	__atomic_fetch_add(&nallocs, 1, __ATOMIC_RELAXED);
+	return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+	__atomic_fetch_add(&nallocs, 1, __ATOMIC_RELAXED);
+	return __libc_realloc(ptr, size);
+}
+
+void
+free(void *ptr)
+{
+	if (ptr)
+		__atomic_fetch_add(&nfrees, 1, __ATOMIC_RELAXED);
+	__libc_free(ptr);
+}
@@ -0,0 +1,9 @@
+/* See LICENSE file for copyright and license details. */
+
+enum { BenchArrange, BenchCommit, BenchMapFrame, BenchLast }; /* metrics */
+
+void benchframe(const void *key);
+void benchmapped(const void *key);
+void benchreport(void);
+void benchstart(int metric);
+void benchstop(int metric);
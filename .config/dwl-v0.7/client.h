@@ -192,6 +192,19 @@ client_get_geometry(Client *c, struct wlr_box *geom)
 	wlr_xdg_surface_get_geometry(c->surface.xdg, geom);
 }
 
+static inline pid_t
+client_get_pid(Client *c)
+{
+	if (c->pid)
+		return c->pid;
+#ifdef XWAYLAND
+	if (client_is_x11(c))
+		return c->pid = c->surface.xwayland->pid;
+#endif
+	wl_client_get_credentials(c->surface.xdg->client->client, &c->pid, NULL, NULL);
+	return c->pid;
+}
+
 static inline Client *
 client_get_parent(Client *c)
 {
@@ -280,30 +293,51 @@ client_is_rendered_on_mon(Client *c, Monitor *m)
 	return 0;
 }
 
+static inline void
+client_poll_stopped(Client *c)
+{
+	/* Read the state of the client's process from procfs, children are
+	 * tracked through SIGCHLD afterwards, see childstatus() */
+	char path[32], buf[512], *s, state;
+	size_t len;
+	int ppid;
+	FILE *f;
+
+	c->stopped = 0;
+#ifdef XWAYLAND
+	if (client_is_x11(c))
+		return;
+#endif
+
+	snprintf(path, sizeof(path), "/proc/%d/stat", (int)client_get_pid(c));
+	if (!(f = fopen(path, "r")))
+		return;
+	len = fread(buf, 1, sizeof(buf) - 1, f);
+	fclose(f);
+	buf[len] = '\0';
+
+	/* The command name may contain spaces and parentheses */
+	if (!(s = strrchr(buf, ')')) || sscanf(s + 1, " %c %d", &state, &ppid) != 2)
+		return;
+	c->stopped = state == 'T' || state == 't';
+	c->ischild = ppid == getpid();
+}
+
 static inline int
 client_is_stopped(Client *c)
 {
-	int pid;
-	siginfo_t in = {0};
 #ifdef XWAYLAND
 	if (client_is_x11(c))
 		return 0;
 #endif
 
-	wl_client_get_credentials(c->surface.xdg->client->client, &pid, NULL, NULL);
-	if (waitid(P_PID, pid, &in, WNOHANG|WCONTINUED|WSTOPPED|WNOWAIT) < 0) {
-		/* This process is not our child process, while is very unluckely that
-		 * it is stopped, in order to do not skip frames assume that it is. */
-		if (errno == ECHILD)
-			return 1;
-	} else if (in.si_pid) {
-		if (in.si_code == CLD_STOPPED || in.si_code == CLD_TRAPPED)
-			return 1;
-		if (in.si_code == CLD_CONTINUED)
-			return 0;
+	/* Nothing tells us when other processes stop, poll them once for each
+	 * pending configure instead of on every frame */
+	if (!c->ischild && c->resize && c->resize != c->stoppedserial) {
+		client_poll_stopped(c);
+		c->stoppedserial = c->resize;
 	}
-
-	return 0;
+	return c->stopped;
 }
 
 static inline int
@@ -353,7 +387,9 @@ static inline void
 client_set_border_color(Client *c, const float color[static 4])
 {
 	int i;
-	for (i = 0; i < 4; i++)
+
+	c->bordercolor = color;
+	for (i = 0; i < 4 && c->border[i]; i++)
 		wlr_scene_rect_set_color(c->border[i], color);
 }
 
@@ -369,6 +405,17 @@ client_set_fullscreen(Client *c, int fullscreen)
 	wlr_xdg_toplevel_set_fullscreen(c->surface.xdg->toplevel, fullscreen);
 }
 
+static inline void
+client_set_minimized(Client *c, int minimized)
+{
+	/* Only X11 clients throttle themselves when minimized, xdg clients
+	 * are suspended, see client_set_suspended() */
+#ifdef XWAYLAND
+	if (client_is_x11(c))
+		wlr_xwayland_surface_set_minimized(c->surface.xwayland, minimized);
+#endif
+}
+
 static inline uint32_t
 client_set_size(Client *c, uint32_t width, uint32_t height)
 {
@@ -20,6 +20,7 @@ static const float urgentcolor[]           = COLOR(0xe67e80ff);
 /* This conforms to the xdg-protocol. Set the alpha to zero to restore the old behavior */
 static const float fullscreen_bg[]         = {0.1f, 0.1f, 0.1f, 1.0f}; /* You can also use glsl colors */
 static const int respect_monitor_reserved_area = 0;  /* 1 to monitor center while respecting the monitor's reserved area, 0 to monitor center */
+static const int resize_timeout            = 200; /* ms to wait for clients to resize before drawing anyway */
 
 /* tagging - TAGCOUNT must be no greater than 31 */
 #define TAGCOUNT (10)
@@ -34,21 +35,39 @@ static const char *const autostart[] = {
         NULL /* terminate */
 };
 
+/* Optional supervision of autostart entries, cmd is matched against their
+ * first word. An entry is ready once a layer surface with namespace or a
+ * window with app_id `ready` maps, entries with `after` set start once that
+ * entry is ready or after autostart_timeout ms. */
+static const Service services[] = {
+	/* cmd        ready          after      restart */
+	{ "wbg",      "wallpaper",   NULL,      1 },
+};
+static const int autostart_timeout = 5000;
+
+/* What happens to windows on hidden tags, set per rule:
+ * HideSuspend:  xdg-shell windows are told they are suspended (default)
+ * HideThrottle: X11 windows are also marked minimized so they throttle
+ * HideStop:     the process is also stopped with SIGSTOP once all of its
+ *               windows were hidden for hidden_stop_delay seconds, and
+ *               continued before any of them is shown again */
+static const int hidden_stop_delay = 30;
+
 
 /* NOTE: ALWAYS keep a rule declared even if you don't use rules (e.g leave at least one example) */
 static const Rule rules[] = {
-	/* app_id                              title                    tags mask     switchtotag     isfloating     monitor     scratchkey     x     y     width     height */
+	/* app_id                              title                    tags mask     switchtotag     isfloating     monitor     scratchkey     x     y     width     height     lazymotion     hidden */
 	/* examples: */
-	{ "Gimp_EXAMPLE",                      NULL,                    0,            1,              1,             -1,         0,             0,    0,    1000,     0.75f }, /* Start on currently visible tags floating, not tiled*/
-	{ "Gimp",                              NULL,                    1 << 4,       1,              1,             -1,         0,             0,    0,    0,        0     }, /* Start on currently visible tags floating, not tiled */
-	{ "firefox",                           NULL,                    1 << 1,       1,              0,             -1,         0,             0,    0,    0,        0     }, /* Start on ONLY tag "9" */
-	{ "thunar",                            NULL,                    1 << 2,       1,              0,             -1,         0,             0,    0,    0,        0     },
-	{ "mousepad",                          NULL,                    1 << 3,       1,              0,             -1,         0,             0,    0,    0,        0     },
-	{ "vesktop",                           NULL,                    1 << 7,       1,              0,             -1,         0,             0,    0,    0,        0     },
-	{ "foot",                              "calcurse",              0,            0,              1,             -1,         0,             930,  40,   700,      500   },
-	{ "nl.hjdskes.gcolor3",                NULL,                    0,            0,              1,             -1,         0,             0,    0,    0,        0     },
-	{ "gcolor3",                           NULL,                    0,            0,              1,             -1,         0,             0,    0,    0,        0     },
-	{ NULL,                                "scratchpad",            0,            0,              1,             -1,         's',           780,  370,  1000,     700   },
+	{ "Gimp_EXAMPLE",                      NULL,                    0,            1,              1,             -1,         0,             0,    0,    1000,     0.75f,     0,             HideStop    }, /* Start on currently visible tags floating, not tiled*/
+	{ "Gimp",                              NULL,                    1 << 4,       1,              1,             -1,         0,             0,    0,    0,        0,         0,             HideSuspend }, /* Start on currently visible tags floating, not tiled */
+	{ "firefox",                           NULL,                    1 << 1,       1,              0,             -1,         0,             0,    0,    0,        0,         0,             HideSuspend }, /* Start on ONLY tag "9" */
+	{ "thunar",                            NULL,                    1 << 2,       1,              0,             -1,         0,             0,    0,    0,        0,         0,             HideSuspend },
+	{ "mousepad",                          NULL,                    1 << 3,       1,              0,             -1,         0,             0,    0,    0,        0,         0,             HideSuspend },
+	{ "vesktop",                           NULL,                    1 << 7,       1,              0,             -1,         0,             0,    0,    0,        0,         0,             HideSuspend },
+	{ "foot",                              "calcurse",              0,            0,              1,             -1,         0,             930,  40,   700,      500,       0,             HideSuspend },
+	{ "nl.hjdskes.gcolor3",                NULL,                    0,            0,              1,             -1,         0,             0,    0,    0,        0,         0,             HideSuspend },
+	{ "gcolor3",                           NULL,                    0,            0,              1,             -1,         0,             0,    0,    0,        0,         0,             HideSuspend },
+	{ NULL,                                "scratchpad",            0,            0,              1,             -1,         's',           780,  370,  1000,     700,       0,             HideSuspend },
 };
 
 /* layout(s) */
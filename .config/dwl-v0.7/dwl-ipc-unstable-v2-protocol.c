@@ -38,7 +38,7 @@ static const struct wl_message zdwl_ipc_manager_v2_events[] = {
 };
 
 WL_PRIVATE const struct wl_interface zdwl_ipc_manager_v2_interface = {
-	"zdwl_ipc_manager_v2", 2,
+	"zdwl_ipc_manager_v2", 3,
 	2, zdwl_ipc_manager_v2_requests,
 	2, zdwl_ipc_manager_v2_events,
 };
@@ -61,11 +61,12 @@ static const struct wl_message zdwl_ipc_output_v2_events[] = {
 	{ "frame", "", dwl_ipc_unstable_v2_types + 0 },
 	{ "fullscreen", "2u", dwl_ipc_unstable_v2_types + 0 },
 	{ "floating", "2u", dwl_ipc_unstable_v2_types + 0 },
+	{ "changes", "3uu", dwl_ipc_unstable_v2_types + 0 },
 };
 
 WL_PRIVATE const struct wl_interface zdwl_ipc_output_v2_interface = {
-	"zdwl_ipc_output_v2", 2,
+	"zdwl_ipc_output_v2", 3,
 	4, zdwl_ipc_output_v2_requests,
-	10, zdwl_ipc_output_v2_events,
+	11, zdwl_ipc_output_v2_events,
 };
 
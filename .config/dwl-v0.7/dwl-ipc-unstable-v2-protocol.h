@@ -77,6 +77,11 @@ extern const struct wl_interface zdwl_ipc_manager_v2_interface;
  * Events are double-buffered:
  * Clients should cache events and redraw when a dwl_ipc_output.frame event is sent.
  *
+ * Starting with version 3 only the state that changed since the previous
+ * frame is sent, announced by a dwl_ipc_output.changes event right before
+ * the frame event. The first frame after creating the object carries the
+ * full state.
+ *
  * Request are not double-buffered:
  * The compositor will update immediately upon request.
  * @section page_iface_zdwl_ipc_output_v2_api API
@@ -90,6 +95,11 @@ extern const struct wl_interface zdwl_ipc_manager_v2_interface;
  * Events are double-buffered:
  * Clients should cache events and redraw when a dwl_ipc_output.frame event is sent.
  *
+ * Starting with version 3 only the state that changed since the previous
+ * frame is sent, announced by a dwl_ipc_output.changes event right before
+ * the frame event. The first frame after creating the object carries the
+ * full state.
+ *
  * Request are not double-buffered:
  * The compositor will update immediately upon request.
  */
@@ -201,6 +211,72 @@ zdwl_ipc_output_v2_tag_state_is_valid(uint32_t value, uint32_t version) {
 }
 #endif /* ZDWL_IPC_OUTPUT_V2_TAG_STATE_ENUM */
 
+#ifndef ZDWL_IPC_OUTPUT_V2_CHANGE_ENUM
+#define ZDWL_IPC_OUTPUT_V2_CHANGE_ENUM
+enum zdwl_ipc_output_v2_change {
+	/**
+	 * active event was sent
+	 */
+	ZDWL_IPC_OUTPUT_V2_CHANGE_ACTIVE = 1,
+	/**
+	 * at least one tag event was sent
+	 */
+	ZDWL_IPC_OUTPUT_V2_CHANGE_TAG = 2,
+	/**
+	 * layout event was sent
+	 */
+	ZDWL_IPC_OUTPUT_V2_CHANGE_LAYOUT = 4,
+	/**
+	 * title event was sent
+	 */
+	ZDWL_IPC_OUTPUT_V2_CHANGE_TITLE = 8,
+	/**
+	 * appid event was sent
+	 */
+	ZDWL_IPC_OUTPUT_V2_CHANGE_APPID = 16,
+	/**
+	 * layout_symbol event was sent
+	 */
+	ZDWL_IPC_OUTPUT_V2_CHANGE_LAYOUT_SYMBOL = 32,
+	/**
+	 * fullscreen event was sent
+	 */
+	ZDWL_IPC_OUTPUT_V2_CHANGE_FULLSCREEN = 64,
+	/**
+	 * floating event was sent
+	 */
+	ZDWL_IPC_OUTPUT_V2_CHANGE_FLOATING = 128,
+};
+/**
+ * @ingroup iface_zdwl_ipc_output_v2
+ * Validate a zdwl_ipc_output_v2 change value.
+ *
+ * @return true on success, false on error.
+ * @ref zdwl_ipc_output_v2_change
+ */
+static inline bool
+zdwl_ipc_output_v2_change_is_valid(uint32_t value, uint32_t version) {
+	uint32_t valid = 0;
+	if (version >= 1)
+		valid |= ZDWL_IPC_OUTPUT_V2_CHANGE_ACTIVE;
+	if (version >= 1)
+		valid |= ZDWL_IPC_OUTPUT_V2_CHANGE_TAG;
+	if (version >= 1)
+		valid |= ZDWL_IPC_OUTPUT_V2_CHANGE_LAYOUT;
+	if (version >= 1)
+		valid |= ZDWL_IPC_OUTPUT_V2_CHANGE_TITLE;
+	if (version >= 1)
+		valid |= ZDWL_IPC_OUTPUT_V2_CHANGE_APPID;
+	if (version >= 1)
+		valid |= ZDWL_IPC_OUTPUT_V2_CHANGE_LAYOUT_SYMBOL;
+	if (version >= 1)
+		valid |= ZDWL_IPC_OUTPUT_V2_CHANGE_FULLSCREEN;
+	if (version >= 1)
+		valid |= ZDWL_IPC_OUTPUT_V2_CHANGE_FLOATING;
+	return (value & ~valid) == 0;
+}
+#endif /* ZDWL_IPC_OUTPUT_V2_CHANGE_ENUM */
+
 /**
  * @ingroup iface_zdwl_ipc_output_v2
  * @struct zdwl_ipc_output_v2_interface
@@ -256,6 +332,7 @@ struct zdwl_ipc_output_v2_interface {
 #define ZDWL_IPC_OUTPUT_V2_FRAME 7
 #define ZDWL_IPC_OUTPUT_V2_FULLSCREEN 8
 #define ZDWL_IPC_OUTPUT_V2_FLOATING 9
+#define ZDWL_IPC_OUTPUT_V2_CHANGES 10
 
 /**
  * @ingroup iface_zdwl_ipc_output_v2
@@ -297,6 +374,10 @@ struct zdwl_ipc_output_v2_interface {
  * @ingroup iface_zdwl_ipc_output_v2
  */
 #define ZDWL_IPC_OUTPUT_V2_FLOATING_SINCE_VERSION 2
+/**
+ * @ingroup iface_zdwl_ipc_output_v2
+ */
+#define ZDWL_IPC_OUTPUT_V2_CHANGES_SINCE_VERSION 3
 
 /**
  * @ingroup iface_zdwl_ipc_output_v2
@@ -435,6 +516,19 @@ zdwl_ipc_output_v2_send_floating(struct wl_resource *resource_, uint32_t is_floa
 	wl_resource_post_event(resource_, ZDWL_IPC_OUTPUT_V2_FLOATING, is_floating);
 }
 
+/**
+ * @ingroup iface_zdwl_ipc_output_v2
+ * Sends an changes event to the client owning the resource.
+ * @param resource_ The client's resource
+ * @param seq sequence number of this frame
+ * @param changes bitmask of the events sent in this frame
+ */
+static inline void
+zdwl_ipc_output_v2_send_changes(struct wl_resource *resource_, uint32_t seq, uint32_t changes)
+{
+	wl_resource_post_event(resource_, ZDWL_IPC_OUTPUT_V2_CHANGES, seq, changes);
+}
+
 #ifdef  __cplusplus
 }
 #endif
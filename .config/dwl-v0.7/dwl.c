@@ -1,12 +1,15 @@
 /*
  * See LICENSE file for copyright and license details.
  */
+#define _GNU_SOURCE /* POSIX_SPAWN_SETSID, see spawnv() */
 #include <limits.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <libinput.h>
 #include <linux/input-event-codes.h>
 #include <math.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/resource.h>
@@ -73,6 +76,16 @@
 
 #include "dwl-ipc-unstable-v2-protocol.h"
 #include "util.h"
+#include "layout.h"
+#ifdef BENCH
+#include "bench/stats.h"
+#else
+#define benchframe(K)
+#define benchmapped(K)
+#define benchreport()
+#define benchstart(M)
+#define benchstop(M)
+#endif
 
 /* macros */
 #define MAX(A, B)               ((A) > (B) ? (A) : (B))
@@ -84,9 +97,12 @@
 #define TAGMASK                 ((1u << TAGCOUNT) - 1)
 #define LISTEN(E, L, H)         wl_signal_add((E), ((L)->notify = (H), (L)))
 #define LISTEN_STATIC(E, H)     do { static struct wl_listener _l = {.notify = (H)}; wl_signal_add((E), &_l); } while (0)
+#define LISTENER_CLIENT(L, M)   (((ClientListeners *)((char *)(L) - offsetof(ClientListeners, M)))->c)
 
 /* enums */
+enum { AutoWaiting, AutoRunning, AutoReady }; /* autostart states */
 enum { CurNormal, CurPressed, CurMove, CurResize }; /* cursor */
+enum { HideSuspend, HideThrottle, HideStop }; /* Rule.hidden */
 enum { XDGShell, LayerShell, X11 }; /* client types */
 enum { LyrBg, LyrBottom, LyrTile, LyrFloat, LyrTop, LyrFS, LyrOverlay, LyrBlock, NUM_LAYERS }; /* scene layers */
 #ifdef XWAYLAND
@@ -109,22 +125,21 @@ typedef struct {
 } Button;
 
 typedef struct Pertag Pertag;
+typedef struct IpcStatus IpcStatus;
 typedef struct Monitor Monitor;
+
+/* idle inhibitors of a window or layer surface, see showinhibitors() */
 typedef struct {
-	/* Must keep these three elements in this order */
-	unsigned int type; /* XDGShell or X11* */
-	struct wlr_box geom; /* layout-relative, includes border */
-	Monitor *mon;
-	struct wlr_scene_tree *scene;
-	struct wlr_scene_rect *border[4]; /* top, bottom, left, right */
-	struct wlr_scene_tree *scene_surface;
-	struct wl_list link;
-	struct wl_list flink;
-	union {
-		struct wlr_xdg_surface *xdg;
-		struct wlr_xwayland_surface *xwayland;
-	} surface;
-	struct wlr_xdg_toplevel_decoration_v1 *decoration;
+	int n;
+	int shown; /* counted in nvisibleinhibitors */
+} InhibitorCount;
+
+typedef struct Client Client;
+
+/* Listeners of a Client, allocated from their own pool so that the
+ * Client slabs the per-monitor lists walk stay dense */
+typedef struct {
+	Client *c;
 	struct wl_listener commit;
 	struct wl_listener map;
 	struct wl_listener maximize;
@@ -134,13 +149,10 @@ typedef struct {
 	struct wl_listener fullscreen;
 	struct wl_listener set_decoration_mode;
 	struct wl_listener destroy_decoration;
-	struct wlr_foreign_toplevel_handle_v1 *foreign_toplevel;
 	struct wl_listener factivate;
 	struct wl_listener fclose;
 	struct wl_listener ffullscreen;
 	struct wl_listener fdestroy;
-	struct wlr_box prev; /* layout-relative, includes border */
-	struct wlr_box bounds;
 #ifdef XWAYLAND
 	struct wl_listener activate;
 	struct wl_listener associate;
@@ -148,20 +160,72 @@ typedef struct {
 	struct wl_listener configure;
 	struct wl_listener set_hints;
 #endif
-	unsigned int bw;
+} ClientListeners;
+
+struct Client {
+	/* Must keep these three elements in this order */
+	unsigned int type; /* XDGShell or X11* */
+	struct wlr_box geom; /* layout-relative, includes border */
+	Monitor *mon;
+
+	/* Read by the loops over all clients (arrange, focus, status, hit
+	 * tests), keep them together in the first two cache lines and put
+	 * anything else below */
+	union {
+		struct wlr_xdg_surface *xdg;
+		struct wlr_xwayland_surface *xwayland;
+	} surface;
+	struct wlr_scene_tree *scene;
 	uint32_t tags;
+	unsigned int bw;
 	int isfloating, isurgent, isfullscreen;
+	uint32_t resize; /* configure serial of a pending resize */
+	struct wl_list link;
+	struct wl_list vlink; /* Monitor.tiled, floating or fullscreen */
+	struct wl_list *vlist; /* list vlink is part of, NULL if hidden */
+	struct wl_list flink;
+
+	struct wlr_scene_rect *border[4]; /* top, bottom, left, right, see updateborder() */
+	const float *bordercolor;
+	struct wlr_scene_tree *scene_surface;
+	struct wl_list titlelink; /* titles */
+	char *title; /* last title propagated, see updatetitle() */
+	struct wlr_box prev; /* layout-relative, includes border */
+	struct wlr_box bounds;
+	struct wlr_box applied, clip; /* last pushed to the scene by resize() */
+	unsigned int appliedbw;
 	int switchtotag;
 	char scratchkey;
-	uint32_t resize; /* configure serial of a pending resize */
-} Client;
+	int lazymotion; /* see pointerfocus() */
+	pid_t pid;
+	int ischild, stopped; /* see client_is_stopped() */
+	uint32_t stoppedserial;
+	int txnlate; /* timed out a transaction, see txnwaiting() */
+	InhibitorCount inhibitors;
+	int hidden; /* Rule.hidden, see hideclient() */
+	int sigstopped; /* its process was stopped by stophidden() */
+	struct wl_event_source *stop_timer;
+	struct wlr_xdg_toplevel_decoration_v1 *decoration;
+	struct wlr_foreign_toplevel_handle_v1 *foreign_toplevel;
+	ClientListeners *ls;
+};
 
 typedef struct {
 	struct wl_list link;
 	struct wl_resource *resource;
 	Monitor *mon;
+	uint32_t seq; /* frames sent, version 3 only */
+	IpcStatus *sent; /* last state sent, version 3 only */
 } DwlIpcOutput;
 
+typedef struct {
+	struct wl_list link;
+	struct wlr_idle_inhibitor_v1 *inhibitor;
+	struct wl_listener destroy;
+	InhibitorCount *owner; /* NULL if it belongs to no window or layer surface */
+	int visible; /* without owner */
+} IdleInhibitor;
+
 typedef struct {
 	uint32_t mod;
 	xkb_keysym_t keysym;
@@ -198,8 +262,20 @@ typedef struct {
 	struct wl_listener destroy;
 	struct wl_listener unmap;
 	struct wl_listener surface_commit;
+	InhibitorCount inhibitors;
 } LayerSurface;
 
+typedef struct {
+	int px, py; /* pixel the result is valid on, see xytonode() */
+	unsigned int gen; /* scenegen the result is valid for, 0 if none */
+	struct wlr_scene_node *node; /* NULL if nothing was hit */
+	struct wl_listener destroy;
+	struct wlr_surface *surface;
+	Client *c;
+	LayerSurface *l;
+	double dx, dy; /* layout to surface-local coordinates */
+} HitTest;
+
 typedef struct {
 	const char *symbol;
 	void (*arrange)(Monitor *);
@@ -230,6 +306,7 @@ struct Monitor {
 	int gappoh;           /* horizontal outer gaps */
 	int gappov;           /* vertical outer gaps */
 	Pertag *pertag;
+	IpcStatus *status; /* last status sent to dwl_ipc_outputs */
 	unsigned int seltags;
 	unsigned int sellt;
 	uint32_t tagset[2];
@@ -238,6 +315,17 @@ struct Monitor {
 	int nmaster;
 	char ltsymbol[16];
 	int asleep;
+	int needarrange; /* relayout pending, see arrangeidle() */
+	/* resize transaction, see txnbegin() */
+	int txnpending;
+	int txnpolled; /* stopped clients were looked for again, see txntimeout() */
+	int txnlatency; /* ms taken by the last transaction */
+	struct timespec txnstart;
+	struct wl_event_source *txn_timer;
+	/* visible clients in tiling order, see reindex() */
+	struct wl_list tiled;
+	struct wl_list floating;
+	struct wl_list fullscreen;
 };
 
 typedef struct {
@@ -251,10 +339,36 @@ typedef struct {
 } MonitorRule;
 
 typedef struct {
+	struct wl_list link; /* constrainttab */
 	struct wlr_pointer_constraint_v1 *constraint;
 	struct wl_listener destroy;
 } PointerConstraint;
 
+typedef struct {
+	struct wl_list link; /* proctab */
+	pid_t pid;
+	const char *name;
+	long autostart; /* index in autostarts or -1 */
+	struct timespec start;
+} Proc;
+
+typedef struct {
+	const char *cmd; /* argv[0] of an autostart entry */
+	const char *ready; /* layer namespace or app_id mapped once it is ready */
+	const char *after; /* cmd of the entry that must be ready first */
+	int restart; /* restart it when it crashes */
+} Service;
+
+typedef struct {
+	const char *const *argv;
+	const Service *svc;
+	pid_t pid;
+	int state;
+	unsigned int restarts; /* crashes in a row */
+	struct timespec launched;
+	struct wl_event_source *restart_timer;
+} Autostart;
+
 typedef struct {
 	const char *id;
 	const char *title;
@@ -267,6 +381,8 @@ typedef struct {
 	float y;
 	float w;
 	float h;
+	int lazymotion;
+	int hidden;
 } Rule;
 
 typedef struct {
@@ -280,22 +396,34 @@ typedef struct {
 
 /* function declarations */
 static void applybounds(Client *c, struct wlr_box *bbox);
+static void applygrab(int force);
+static void applylayout(Monitor *m, LayoutFunc fn, LayoutParams p);
 static void applyrules(Client *c, bool map);
 static void arrange(Monitor *m);
+static void arrangeidle(void *data);
+static void arrangemon(Monitor *m);
 static void arrangelayer(Monitor *m, struct wl_list *list,
 		struct wlr_box *usable_area, int exclusive);
 static void arrangelayers(Monitor *m);
 static void autostartexec(void);
+static void autostartexit(Autostart *a, const siginfo_t *in, long lifetime);
+static void autostartlaunch(size_t i);
+static void autostartnotify(const char *name);
+static void autostartready(size_t i);
+static int autostartrestart(void *data);
+static int autostarttimeout(void *data);
 static void axisnotify(struct wl_listener *listener, void *data);
+static unsigned int bindhash(uint32_t mod, uint32_t code);
 static void buttonpress(struct wl_listener *listener, void *data);
 static void chvt(const Arg *arg);
-static void checkidleinhibitor(struct wlr_surface *exclude);
+static int childstatus(int signo, void *data);
 static void cleanup(void);
 static void cleanupmon(struct wl_listener *listener, void *data);
 static void closemon(Monitor *m);
 static void commitlayersurfacenotify(struct wl_listener *listener, void *data);
 static void commitnotify(struct wl_listener *listener, void *data);
 static void commitpopup(struct wl_listener *listener, void *data);
+static void contprocess(pid_t pid);
 static void createdecoration(struct wl_listener *listener, void *data);
 static void createidleinhibitor(struct wl_listener *listener, void *data);
 static void createkeyboard(struct wlr_keyboard *keyboard);
@@ -307,6 +435,7 @@ static void createnotify(struct wl_listener *listener, void *data);
 static void createpointer(struct wlr_pointer *pointer);
 static void createpointerconstraint(struct wl_listener *listener, void *data);
 static void createpopup(struct wl_listener *listener, void *data);
+static struct wlr_pointer_constraint_v1 *constraintat(struct wlr_surface *surface);
 static void cursorconstrain(struct wlr_pointer_constraint_v1 *constraint);
 static void cursorframe(struct wl_listener *listener, void *data);
 static void cyclelayout(const Arg *arg);
@@ -315,6 +444,7 @@ static void deck(Monitor *m);
 static void defaultgaps(const Arg *arg);
 static void destroydecoration(struct wl_listener *listener, void *data);
 static void destroydragicon(struct wl_listener *listener, void *data);
+static void destroyhitnode(struct wl_listener *listener, void *data);
 static void destroyidleinhibitor(struct wl_listener *listener, void *data);
 static void destroylayersurfacenotify(struct wl_listener *listener, void *data);
 static void destroylock(SessionLock *lock, int unlocked);
@@ -324,6 +454,7 @@ static void destroypointerconstraint(struct wl_listener *listener, void *data);
 static void destroysessionlock(struct wl_listener *listener, void *data);
 static void destroysessionmgr(struct wl_listener *listener, void *data);
 static void destroykeyboardgroup(struct wl_listener *listener, void *data);
+static void detachinhibitors(InhibitorCount *ic);
 static Monitor *dirtomon(enum wlr_direction dir);
 static void dwl_ipc_manager_bind(struct wl_client *client, void *data, uint32_t version, uint32_t id);
 static void dwl_ipc_manager_destroy(struct wl_resource *resource);
@@ -334,8 +465,12 @@ static void dwl_ipc_output_printstatus(Monitor *monitor);
 static void dwl_ipc_output_printstatus_to(DwlIpcOutput *ipc_output);
 static void dwl_ipc_output_set_client_tags(struct wl_client *client, struct wl_resource *resource, uint32_t and_tags, uint32_t xor_tags);
 static void dwl_ipc_output_set_layout(struct wl_client *client, struct wl_resource *resource, uint32_t index);
+static int dwl_ipc_output_status_update(Monitor *monitor);
 static void dwl_ipc_output_set_tags(struct wl_client *client, struct wl_resource *resource, uint32_t tagmask, uint32_t toggle_tagset);
 static void dwl_ipc_output_release(struct wl_client *client, struct wl_resource *resource);
+static Proc *findproc(pid_t pid);
+static void flushmotion(void);
+static void flushtitles(Monitor *m);
 static void focusclient(Client *c, int lift);
 static void focusmon(const Arg *arg);
 static void focusortogglematchingscratch(const Arg *arg);
@@ -347,7 +482,11 @@ static void fullscreennotify(struct wl_listener *listener, void *data);
 static void gpureset(struct wl_listener *listener, void *data);
 static void gaplessgrid(Monitor *m);
 static void handlesig(int signo);
+static void hashbindings(void);
+static void hideclient(Client *c, int hide);
+static int hitchanged(struct wlr_surface *surface);
 static void incnmaster(const Arg *arg);
+static void indexmons(void);
 static void incgaps(const Arg *arg);
 static void incigaps(const Arg *arg);
 static void incihgaps(const Arg *arg);
@@ -362,6 +501,7 @@ static void keypressmod(struct wl_listener *listener, void *data);
 static int keyrepeat(void *data);
 static void killclient(const Arg *arg);
 static void locksession(struct wl_listener *listener, void *data);
+static int logstats(int signo, void *data);
 static void mapnotify(struct wl_listener *listener, void *data);
 static void maximizenotify(struct wl_listener *listener, void *data);
 static void monocle(Monitor *m);
@@ -377,8 +517,13 @@ static void outputmgrtest(struct wl_listener *listener, void *data);
 static void pointerfocus(Client *c, struct wlr_surface *surface,
 		double sx, double sy, uint32_t time);
 static void printstatus(void);
+static void printstatusidle(void *data);
+static void propagatetitle(Client *c);
 static void powermgrsetmode(struct wl_listener *listener, void *data);
 static void quit(const Arg *arg);
+static void reindex(Client *c);
+static void reindexmon(Monitor *m);
+static const unsigned long *rulematch(const char *appid, const char *title);
 static void restorerlimit(void);
 static void rendermon(struct wl_listener *listener, void *data);
 static void requestdecorationmode(struct wl_listener *listener, void *data);
@@ -401,9 +546,12 @@ static void setmon(Client *c, Monitor *m, uint32_t newtags);
 static void setpsel(struct wl_listener *listener, void *data);
 static void setsel(struct wl_listener *listener, void *data);
 static void setup(void);
+static void showinhibitors(InhibitorCount *ic, int shown);
 static void spawn(const Arg *arg);
 static void spawnscratch(const Arg *arg);
+static pid_t spawnv(char *const argv[], int fdin, int fdout);
 static void startdrag(struct wl_listener *listener, void *data);
+static int stophidden(void *data);
 static void tag(const Arg *arg);
 static void tagmon(const Arg *arg);
 static void tile(Monitor *m);
@@ -417,13 +565,20 @@ static void movecenter(const Arg *arg);
 static void moveresizekb(const Arg *arg);
 static void toggletag(const Arg *arg);
 static void toggleview(const Arg *arg);
+static Proc *trackproc(pid_t pid, const char *name);
+static void txnbegin(Monitor *m);
+static void txnend(Monitor *m, int timedout);
+static int txntimeout(void *data);
+static int txnwaiting(Monitor *m);
 static void unlocksession(struct wl_listener *listener, void *data);
 static void unmaplayersurfacenotify(struct wl_listener *listener, void *data);
 static void unmapnotify(struct wl_listener *listener, void *data);
+static void updateborder(Client *c);
 static void updatemons(struct wl_listener *listener, void *data);
 static void updatetitle(struct wl_listener *listener, void *data);
 static void urgent(struct wl_listener *listener, void *data);
 static void view(const Arg *arg);
+static struct wl_list *visiblelist(Client *c);
 static void virtualkeyboard(struct wl_listener *listener, void *data);
 static void virtualpointer(struct wl_listener *listener, void *data);
 static Monitor *xytomon(double x, double y);
@@ -441,12 +596,21 @@ static void ffullscreennotify(struct wl_listener *listener, void *data);
 
 /* variables */
 static const char broken[] = "broken";
-static struct rlimit og_rlimit;
+extern char **environ;
+static struct rlimit og_rlimit, new_rlimit;
+static unsigned long nspawned;
+static long spawnlatency, spawnlatencymax; /* us, see spawnv() */
+static struct wl_list proctab[64]; /* Proc by pid, children spawned by spawnv() */
 static pid_t child_pid = -1;
 static int locked;
 static void *exclusive_focus;
 static struct wl_display *dpy;
 static struct wl_event_loop *event_loop;
+static struct wl_event_source *arrange_idle;
+static struct wl_event_source *status_idle;
+static struct wl_event_source *sigchld_source, *sigusr1_source;
+static struct wl_list inhibitors; /* IdleInhibitor */
+static int nvisibleinhibitors;
 static struct wlr_backend *backend;
 static struct wlr_scene *scene;
 static struct wlr_scene_tree *layers[NUM_LAYERS];
@@ -463,6 +627,7 @@ static struct wlr_xdg_activation_v1 *activation;
 static struct wlr_xdg_decoration_manager_v1 *xdg_decoration_mgr;
 static struct wl_list clients; /* tiling order */
 static struct wl_list fstack;  /* focus order */
+static struct wl_list titles;  /* clients with a pending title change */
 static struct wlr_idle_notifier_v1 *idle_notifier;
 static struct wlr_idle_inhibit_manager_v1 *idle_inhibit_mgr;
 static struct wlr_layer_shell_v1 *layer_shell;
@@ -476,6 +641,7 @@ static struct wlr_output_power_manager_v1 *power_mgr;
 static struct wlr_pointer_constraints_v1 *pointer_constraints;
 static struct wlr_relative_pointer_manager_v1 *relative_pointer_mgr;
 static struct wlr_pointer_constraint_v1 *active_constraint;
+static struct wl_list constrainttab[64]; /* PointerConstraint by surface */
 
 static struct wlr_cursor *cursor;
 static struct wlr_xcursor_manager *cursor_mgr;
@@ -493,13 +659,34 @@ static KeyboardGroup *kb_group;
 static unsigned int cursor_mode;
 static Client *grabc;
 static int grabcx, grabcy; /* client-relative */
+static struct wlr_box grabgeom; /* pending geometry of grabc, see applygrab() */
+static int grabpending;
+static Monitor *grabmon;
+static struct wlr_surface *motionsurface; /* pending motion, see pointerfocus() */
+static double motionsx, motionsy;
+static uint32_t motiontime;
+static Monitor *motionmon;
+static int framepending; /* events sent since the last wl_pointer.frame */
 
 static struct wlr_output_layout *output_layout;
 static struct wlr_box sgeom;
 static struct wl_list mons;
 static Monitor *selmon;
+static HitTest hitcache;
+static unsigned int scenegen = 1; /* bumped when hit-test results may have changed */
+static Monitor **monindex; /* mons in list order, see indexmons() */
+static int nmonindex;
 
 static int enablegaps = 1;   /* enables gaps, used by togglegaps */
+static int nsigstopped; /* clients with sigstopped set */
+
+/* frequently created objects, statistics are logged on SIGUSR1 */
+static Pool clientpool = {.name = "Client", .size = sizeof(Client)};
+static Pool listenerpool = {.name = "ClientListeners", .size = sizeof(ClientListeners)};
+static Pool layerpool = {.name = "LayerSurface", .size = sizeof(LayerSurface)};
+static Pool ipcoutputpool = {.name = "DwlIpcOutput", .size = sizeof(DwlIpcOutput)};
+static Pool constraintpool = {.name = "PointerConstraint", .size = sizeof(PointerConstraint)};
+static Pool *const pools[] = {&clientpool, &listenerpool, &layerpool, &ipcoutputpool, &constraintpool};
 
 static struct zdwl_ipc_manager_v2_interface dwl_manager_implementation = {.release = dwl_ipc_manager_release, .get_output = dwl_ipc_manager_get_output};
 static struct zdwl_ipc_output_v2_interface dwl_output_implementation = {.release = dwl_ipc_output_release, .set_tags = dwl_ipc_output_set_tags, .set_layout = dwl_ipc_output_set_layout, .set_client_tags = dwl_ipc_output_set_client_tags};
@@ -523,8 +710,30 @@ static xcb_atom_t netatom[NetLast];
 /* attempt to encapsulate suck into one file */
 #include "client.h"
 
-static pid_t *autostart_pids;
+static Autostart *autostarts;
 static size_t autostart_len;
+static struct wl_event_source *autostart_timer;
+
+/* rules matching an appid and title, see rulematch() */
+#define ULBITS (8 * sizeof(unsigned long))
+typedef struct {
+	char *appid, *title;
+	unsigned long match[(LENGTH(rules) + ULBITS - 1) / ULBITS];
+} RuleMatch;
+static RuleMatch rulecache[64];
+
+/* keys and buttons chained by bindhash(), indices are offset by one so
+ * that 0 ends a chain, see hashbindings() */
+#define BINDBITS 10
+static unsigned int keyhead[1 << BINDBITS], keynext[LENGTH(keys)];
+static unsigned int buttonhead[1 << BINDBITS], buttonnext[LENGTH(buttons)];
+
+typedef struct {
+	LayoutFunc fn;
+	LayoutParams p;
+	int n, size; /* boxes used and allocated */
+	struct wlr_box *boxes;
+} LayoutCache;
 
 struct Pertag {
 	unsigned int curtag, prevtag; /* current and previous tag */
@@ -532,6 +741,19 @@ struct Pertag {
 	float mfacts[TAGCOUNT + 1]; /* mfacts per tag */
 	unsigned int sellts[TAGCOUNT + 1]; /* selected layouts */
 	const Layout *ltidxs[TAGCOUNT + 1][2]; /* matrix of tags and layouts indexes  */
+	LayoutCache layouts[TAGCOUNT + 1]; /* last boxes computed, see applylayout() */
+};
+
+struct IpcStatus {
+	int active;
+	uint32_t tagset;  /* selected tags */
+	uint32_t urgent;  /* tags with an urgent client */
+	uint32_t focused; /* tags of the focused client */
+	unsigned int nclients[TAGCOUNT];
+	unsigned int layout;
+	char ltsymbol[16];
+	char *title, *appid;
+	int fullscreen, floating;
 };
 
 /* function implementations */
@@ -552,6 +774,58 @@ applybounds(Client *c, struct wlr_box *bbox)
 		c->geom.y = bbox->y;
 }
 
+void
+applygrab(int force)
+{
+	/* Move and resize grabc at most once per frame of the monitor under the
+	 * cursor, see motionnotify(). A resize also waits for the client to ack
+	 * the previous one instead of flooding it with configures. */
+	if (!grabpending || !grabc)
+		return;
+	if (!force && cursor_mode == CurResize && grabc->resize && !client_is_stopped(grabc))
+		return;
+	grabpending = 0;
+	resize(grabc, grabgeom, 1);
+}
+
+void
+applylayout(Monitor *m, LayoutFunc fn, LayoutParams p)
+{
+	/* Compute the boxes of all tiled clients at once, then apply them.
+	 * The boxes only depend on the layout, its parameters and the number
+	 * of windows, so they are kept per tag: switching back to a tag where
+	 * none of these changed reuses them and skips resize() for clients
+	 * that are still where they were put. Client commits keep their clip
+	 * up to date meanwhile, see commitnotify(). */
+	LayoutCache *lc = &m->pertag->layouts[m->pertag->curtag];
+	Client *c;
+	int i = 0, hit = 1, n = wl_list_length(&m->tiled);
+
+	if (n == 0)
+		return;
+	p.area = m->w;
+	/* LayoutParams has no padding */
+	if (lc->fn != fn || lc->n != n || memcmp(&lc->p, &p, sizeof(p))) {
+		if (n > lc->size) {
+			free(lc->boxes);
+			lc->boxes = ecalloc(n, sizeof(*lc->boxes));
+			lc->size = n;
+		}
+		fn(&p, n, lc->boxes);
+		lc->fn = fn;
+		lc->n = n;
+		lc->p = p;
+		hit = 0;
+	}
+	wl_list_for_each(c, &m->tiled, vlink) {
+		if (!hit || !wlr_box_equal(&lc->boxes[i], &c->geom)
+				|| !wlr_box_equal(&c->geom, &c->applied)
+				|| c->bw != c->appliedbw)
+			resize(c, lc->boxes[i], 0);
+		i++;
+	}
+}
+
 void
 applyrules(Client *c, bool map)
 {
@@ -560,7 +834,8 @@ applyrules(Client *c, bool map)
 	uint32_t newtags = 0;
 	int i;
 	const Rule *r;
-	Monitor *mon = selmon, *m;
+	const unsigned long *match;
+	Monitor *mon = selmon;
 	struct wlr_box b;
 	int newx;
 	int newy;
@@ -570,6 +845,8 @@ applyrules(Client *c, bool map)
 
 	c->isfloating = client_is_float_type(c);
 	c->scratchkey = 0;
+	c->lazymotion = 0;
+	c->hidden = HideSuspend;
 	if (!(appid = client_get_appid(c)))
 		appid = broken;
 	if (!(title = client_get_title(c)))
@@ -580,21 +857,22 @@ applyrules(Client *c, bool map)
 		wlr_foreign_toplevel_handle_v1_set_title(c->foreign_toplevel, title);
 	}
 
-	for (r = rules; r < END(rules); r++) {
-		if ((!r->title || strstr(title, r->title))
-				&& (!r->id || strstr(appid, r->id))) {
+	match = rulematch(appid, title);
+	for (i = 0; i < (int)LENGTH(rules); i++) {
+		r = &rules[i];
+		if (match[i / ULBITS] & 1UL << i % ULBITS) {
 			c->isfloating = r->isfloating;
 			c->scratchkey = r->scratchkey;
+			c->lazymotion = r->lazymotion;
+			c->hidden = r->hidden;
 			newtags |= r->tags;
-			i = 0;
-			wl_list_for_each(m, &mons, link) {
-				if (r->monitor == i++)
-					mon = m;
-			}
+			if (r->monitor >= 0 && r->monitor < nmonindex)
+				mon = monindex[r->monitor];
 			if (r->switchtotag && map) {
 				c->switchtotag = selmon->tagset[selmon->seltags];
 				mon->seltags ^= 1;
 				mon->tagset[selmon->seltags] = r->tags & TAGMASK;
+				reindexmon(mon);
 			}
 			if (c->isfloating || !mon->lt[mon->sellt]->arrange) {
 				/* client is floating or in floating layout */
@@ -633,42 +911,67 @@ applyrules(Client *c, bool map)
 
 void
 arrange(Monitor *m)
+{
+	/* Only mark the monitor dirty; the actual relayout runs once from an
+	 * idle callback after all events of this dispatch were handled. The
+	 * layout symbol is updated right away since printstatus() reads it. */
+	strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, LENGTH(m->ltsymbol));
+	m->needarrange = 1;
+	scenegen++;
+	if (!arrange_idle)
+		arrange_idle = wl_event_loop_add_idle(event_loop, arrangeidle, NULL);
+}
+
+void
+arrangeidle(void *data)
+{
+	Monitor *m;
+	int arranged = 0;
+
+	arrange_idle = NULL;
+	wl_list_for_each(m, &mons, link) {
+		if (!m->needarrange)
+			continue;
+		m->needarrange = 0;
+		arrangemon(m);
+		arranged = 1;
+	}
+
+	if (!arranged)
+		return;
+	motionnotify(0, NULL, 0, 0, 0, 0);
+	/* layouts like monocle update the layout symbol */
+	printstatus();
+}
+
+void
+arrangemon(Monitor *m)
 {
 	Client *c;
 
 	if (!m->wlr_output->enabled)
 		return;
 
-	wl_list_for_each(c, &clients, link) {
-		if (c->mon == m) {
-			wlr_scene_node_set_enabled(&c->scene->node, VISIBLEON(c, m));
-			client_set_suspended(c, !VISIBLEON(c, m));
-		}
-	}
-
+	/* Scene node and suspended state of clients are kept in sync with
+	 * their visibility by reindex() */
 	wlr_scene_node_set_enabled(&m->fullscreen_bg->node,
 			(c = focustop(m)) && c->isfullscreen);
 
-	strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, LENGTH(m->ltsymbol));
-
 	/* We move all clients (except fullscreen and unmanaged) to LyrTile while
 	 * in floating layout to avoid "real" floating clients be always on top */
-	wl_list_for_each(c, &clients, link) {
-		if (c->mon != m || c->scene->node.parent == layers[LyrFS])
+	wl_list_for_each(c, &m->floating, vlink) {
+		if (c->scene->node.parent == layers[LyrFS])
 			continue;
 
-		wlr_scene_node_reparent(&c->scene->node,
-				(!m->lt[m->sellt]->arrange && c->isfloating)
-						? layers[LyrTile]
-						: (m->lt[m->sellt]->arrange && c->isfloating)
-								? layers[LyrFloat]
-								: c->scene->node.parent);
+		wlr_scene_node_reparent(&c->scene->node, m->lt[m->sellt]->arrange
+				? layers[LyrFloat] : layers[LyrTile]);
 	}
 
+	benchstart(BenchArrange);
 	if (m->lt[m->sellt]->arrange)
 		m->lt[m->sellt]->arrange(m);
-	motionnotify(0, NULL, 0, 0, 0, 0);
-	checkidleinhibitor(NULL);
+	benchstop(BenchArrange);
+	txnbegin(m);
 }
 
 void
@@ -732,23 +1035,151 @@ arrangelayers(Monitor *m)
 
 void
 autostartexec(void) {
+	/* Entries start in parallel, except those whose Service waits for
+	 * another entry to be ready, see autostartready() */
 	const char *const *p;
-	size_t i = 0;
+	const Service *svc;
+	size_t i = 0, j;
+	int waiting = 0;
 
 	/* count entries */
 	for (p = autostart; *p; autostart_len++, p++)
 		while (*++p);
 
-	autostart_pids = calloc(autostart_len, sizeof(pid_t));
+	autostarts = ecalloc(autostart_len, sizeof(*autostarts));
 	for (p = autostart; *p; i++, p++) {
-		if ((autostart_pids[i] = fork()) == 0) {
-			setsid();
-			execvp(*p, (char *const *)p);
-			die("dwl: execvp %s:", *p);
+		autostarts[i].argv = p;
+		autostarts[i].pid = -1;
+		for (svc = services; svc < END(services); svc++) {
+			if (svc->cmd && !strcmp(svc->cmd, *p))
+				autostarts[i].svc = svc;
 		}
 		/* skip arguments */
 		while (*++p);
 	}
+
+	for (i = 0; i < autostart_len; i++) {
+		svc = autostarts[i].svc;
+		for (j = 0; svc && svc->after && j < autostart_len; j++) {
+			if (j != i && !strcmp(*autostarts[j].argv, svc->after))
+				break;
+		}
+		if (svc && svc->after && j < autostart_len) {
+			waiting = 1;
+			continue;
+		}
+		autostartlaunch(i);
+	}
+
+	/* don't wait forever for entries that never get ready */
+	if (waiting) {
+		autostart_timer = wl_event_loop_add_timer(event_loop, autostarttimeout, NULL);
+		wl_event_source_timer_update(autostart_timer, autostart_timeout);
+	}
+}
+
+void
+autostartexit(Autostart *a, const siginfo_t *in, long lifetime)
+{
+	/* Restart crashed services with an exponential backoff, reset once
+	 * they stayed up for a minute */
+	int delay;
+
+	a->pid = -1;
+	if (!a->svc || !a->svc->restart || (in->si_code == CLD_EXITED && !in->si_status)) {
+		autostartready(a - autostarts); /* done, don't hold back dependents */
+		return;
+	}
+	a->state = AutoWaiting;
+
+	if (lifetime >= 60)
+		a->restarts = 0;
+	delay = 1000 << MIN(a->restarts, 5);
+	a->restarts++;
+	wlr_log(WLR_INFO, "autostart: restarting %s in %d ms", *a->argv, delay);
+	if (!a->restart_timer)
+		a->restart_timer = wl_event_loop_add_timer(event_loop, autostartrestart, a);
+	wl_event_source_timer_update(a->restart_timer, delay);
+}
+
+void
+autostartlaunch(size_t i)
+{
+	Autostart *a = &autostarts[i];
+
+	clock_gettime(CLOCK_MONOTONIC, &a->launched);
+	/* a failed entry doesn't hold back its dependents */
+	if ((a->pid = spawnv((char *const *)a->argv, -1, -1)) < 0) {
+		autostartready(i);
+		return;
+	}
+	findproc(a->pid)->autostart = i;
+	a->state = AutoRunning;
+	if (!a->svc || !a->svc->ready)
+		autostartready(i);
+}
+
+void
+autostartnotify(const char *name)
+{
+	/* A layer surface or window called name was mapped */
+	size_t i;
+
+	for (i = 0; name && i < autostart_len; i++) {
+		if (autostarts[i].state == AutoRunning && autostarts[i].svc
+				&& autostarts[i].svc->ready && !strcmp(autostarts[i].svc->ready, name))
+			autostartready(i);
+	}
+}
+
+void
+autostartready(size_t i)
+{
+	Autostart *a = &autostarts[i];
+	struct timespec now;
+	size_t j;
+
+	if (a->state == AutoReady)
+		return;
+	a->state = AutoReady;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	wlr_log(WLR_INFO, "autostart: %s ready after %ld ms", *a->argv,
+			(now.tv_sec - a->launched.tv_sec) * 1000
+			+ (now.tv_nsec - a->launched.tv_nsec) / 1000000);
+
+	/* crashed dependents wait for their restart timer */
+	for (j = 0; j < autostart_len; j++) {
+		if (autostarts[j].state == AutoWaiting && autostarts[j].pid < 0
+				&& !autostarts[j].restart_timer
+				&& autostarts[j].svc && autostarts[j].svc->after
+				&& !strcmp(autostarts[j].svc->after, *a->argv))
+			autostartlaunch(j);
+	}
+}
+
+int
+autostartrestart(void *data)
+{
+	Autostart *a = data;
+
+	if (a->state == AutoWaiting && a->pid < 0)
+		autostartlaunch(a - autostarts);
+	return 0;
+}
+
+int
+autostarttimeout(void *data)
+{
+	size_t i;
+
+	for (i = 0; i < autostart_len; i++) {
+		if (autostarts[i].state == AutoWaiting && autostarts[i].pid < 0
+				&& !autostarts[i].restart_timer) {
+			wlr_log(WLR_INFO, "autostart: starting %s without waiting", *autostarts[i].argv);
+			autostartlaunch(i);
+		}
+	}
+	return 0;
 }
 
 void
@@ -758,12 +1189,20 @@ axisnotify(struct wl_listener *listener, void *data)
 	 * for example when you move the scroll wheel. */
 	struct wlr_pointer_axis_event *event = data;
 	wlr_idle_notifier_v1_notify_activity(idle_notifier, seat);
+	flushmotion();
 	/* TODO: allow usage of scroll whell for mousebindings, it can be implemented
 	 * checking the event's orientation and the delta of the event */
 	/* Notify the client with pointer focus of the axis event. */
 	wlr_seat_pointer_notify_axis(seat,
 			event->time_msec, event->orientation, event->delta,
 			event->delta_discrete, event->source, event->relative_direction);
+	framepending = 1;
+}
+
+unsigned int
+bindhash(uint32_t mod, uint32_t code)
+{
+	return ((CLEANMASK(mod) * 31 + code) * 2654435761u) >> (32 - BINDBITS);
 }
 
 void
@@ -774,8 +1213,10 @@ buttonpress(struct wl_listener *listener, void *data)
 	uint32_t mods;
 	Client *c;
 	const Button *b;
+	unsigned int i;
 
 	wlr_idle_notifier_v1_notify_activity(idle_notifier, seat);
+	flushmotion();
 
 	switch (event->state) {
 	case WL_POINTER_BUTTON_STATE_PRESSED:
@@ -791,9 +1232,10 @@ buttonpress(struct wl_listener *listener, void *data)
 
 		keyboard = wlr_seat_get_keyboard(seat);
 		mods = keyboard ? wlr_keyboard_get_modifiers(keyboard) : 0;
-		for (b = buttons; b < END(buttons); b++) {
+		for (i = buttonhead[bindhash(mods, event->button)]; i; i = buttonnext[i - 1]) {
+			b = &buttons[i - 1];
 			if (CLEANMASK(mods) == CLEANMASK(b->mod) &&
-					event->button == b->button && b->func) {
+					event->button == b->button) {
 				b->func(&b->arg);
 				return;
 			}
@@ -804,6 +1246,7 @@ buttonpress(struct wl_listener *listener, void *data)
 		/* TODO should reset to the pointer focus's current setcursor */
 		if (!locked && cursor_mode != CurNormal && cursor_mode != CurPressed) {
 			wlr_cursor_set_xcursor(cursor, cursor_mgr, "default");
+			applygrab(1);
 			cursor_mode = CurNormal;
 			/* Drop the window off on its new monitor */
 			selmon = xytomon(cursor->x, cursor->y);
@@ -818,6 +1261,7 @@ buttonpress(struct wl_listener *listener, void *data)
 	 * pointer focus that a button press has occurred */
 	wlr_seat_pointer_notify_button(seat,
 			event->time_msec, event->button, event->state);
+	framepending = 1;
 }
 
 void
@@ -826,28 +1270,74 @@ chvt(const Arg *arg)
 	wlr_session_change_vt(session, arg->ui);
 }
 
-void
-checkidleinhibitor(struct wlr_surface *exclude)
+int
+childstatus(int signo, void *data)
 {
-	int inhibited = 0, unused_lx, unused_ly;
-	struct wlr_idle_inhibitor_v1 *inhibitor;
-	wl_list_for_each(inhibitor, &idle_inhibit_mgr->inhibitors, link) {
-		struct wlr_surface *surface = wlr_surface_get_root_surface(inhibitor->surface);
-		struct wlr_scene_tree *tree = surface->data;
-		if (exclude != surface && (bypass_surface_visibility || (!tree
-				|| wlr_scene_node_coords(&tree->node, &unused_lx, &unused_ly)))) {
-			inhibited = 1;
-			break;
-		}
+	/* SIGCHLD is read from a signalfd by the event loop, so unlike a signal
+	 * handler this may touch any compositor state */
+	Client *c;
+	Proc *p;
+	siginfo_t in;
+	struct timespec now;
+
+	/* wlroots expects to reap the XWayland process itself, so we
+	 * use WNOWAIT to keep the child waitable until we know it's not
+	 * XWayland.
+	 */
+	while (!waitid(P_ALL, 0, &in, WEXITED|WNOHANG|WNOWAIT) && in.si_pid
+#ifdef XWAYLAND
+		   && (!xwayland || in.si_pid != xwayland->server->pid)
+#endif
+		   ) {
+		waitpid(in.si_pid, NULL, 0);
+		if (in.si_pid == child_pid)
+			child_pid = -1;
+		if (!(p = findproc(in.si_pid)))
+			continue;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		wlr_log(WLR_INFO, "%s (pid %d%s) %s %d after %ld s", p->name, p->pid,
+				p->autostart >= 0 ? ", autostart" : "",
+				in.si_code == CLD_EXITED ? "exited with status" : "killed by signal",
+				in.si_status, (long)(now.tv_sec - p->start.tv_sec));
+		if (p->autostart >= 0)
+			autostartexit(&autostarts[p->autostart], &in, now.tv_sec - p->start.tv_sec);
+		wl_list_remove(&p->link);
+		free(p);
 	}
 
-	wlr_idle_notifier_v1_set_inhibited(idle_notifier, inhibited);
+	/* Cache stopped and continued clients, see client_is_stopped(). Like
+	 * above, XWayland's notifications are left for wlroots. */
+	while (!waitid(P_ALL, 0, &in, WSTOPPED|WCONTINUED|WNOHANG|WNOWAIT) && in.si_pid
+#ifdef XWAYLAND
+		   && (!xwayland || in.si_pid != xwayland->server->pid)
+#endif
+		   ) {
+		if (waitid(P_PID, (id_t)in.si_pid, &in, WSTOPPED|WCONTINUED|WNOHANG) || !in.si_pid)
+			continue;
+		wl_list_for_each(c, &clients, link) {
+			if (c->pid != in.si_pid)
+				continue;
+			c->stopped = in.si_code != CLD_CONTINUED;
+			/* rendermon() may be waiting for it */
+			if (c->mon)
+				wlr_output_schedule_frame(c->mon->wlr_output);
+		}
+	}
+	return 0;
 }
 
 void
 cleanup(void)
 {
+	Client *c;
 	size_t i;
+
+	benchreport();
+	/* a stopped process would never see its connection close */
+	wl_list_for_each(c, &clients, link)
+		if (c->sigstopped)
+			kill(c->pid, SIGCONT);
 #ifdef XWAYLAND
 	wlr_xwayland_destroy(xwayland);
 	xwayland = NULL;
@@ -856,11 +1346,16 @@ cleanup(void)
 
 	/* kill child processes */
 	for (i = 0; i < autostart_len; i++) {
-		if (0 < autostart_pids[i]) {
-			kill(autostart_pids[i], SIGTERM);
-			waitpid(autostart_pids[i], NULL, 0);
+		if (autostarts[i].restart_timer)
+			wl_event_source_remove(autostarts[i].restart_timer);
+		if (0 < autostarts[i].pid) {
+			kill(autostarts[i].pid, SIGTERM);
+			waitpid(autostarts[i].pid, NULL, 0);
 		}
 	}
+	if (autostart_timer)
+		wl_event_source_remove(autostart_timer);
+	free(autostarts);
 
 	if (child_pid > 0) {
 		kill(-child_pid, SIGTERM);
@@ -874,10 +1369,23 @@ cleanup(void)
 	 * Destroy it until it's fixed in the wlroots side */
 	wlr_backend_destroy(backend);
 
+	if (arrange_idle)
+		wl_event_source_remove(arrange_idle);
+	if (status_idle)
+		wl_event_source_remove(status_idle);
+	wl_event_source_remove(sigchld_source);
+	wl_event_source_remove(sigusr1_source);
 	wl_display_destroy(dpy);
+	free(monindex);
+	for (i = 0; i < LENGTH(rulecache); i++) {
+		free(rulecache[i].appid);
+		free(rulecache[i].title);
+	}
 	/* Destroy after the wayland display (when the monitors are already destroyed)
 	   to avoid destroying them with an invalid scene output. */
 	wlr_scene_node_destroy(&scene->tree.node);
+	for (i = 0; i < LENGTH(pools); i++)
+		pooldestroy(pools[i]);
 }
 
 void
@@ -900,12 +1408,27 @@ cleanupmon(struct wl_listener *listener, void *data)
 	wl_list_remove(&m->destroy.link);
 	wl_list_remove(&m->frame.link);
 	wl_list_remove(&m->link);
+	indexmons();
 	wl_list_remove(&m->request_state.link);
+	wl_event_source_remove(m->txn_timer);
+	if (grabmon == m) {
+		applygrab(1);
+		grabmon = NULL;
+	}
+	if (motionmon == m) {
+		flushmotion();
+		motionmon = NULL;
+	}
 	m->wlr_output->data = NULL;
 	wlr_output_layout_remove(output_layout, m->wlr_output);
 	wlr_scene_output_destroy(m->scene_output);
 
+	for (i = 0; i < LENGTH(m->pertag->layouts); i++)
+		free(m->pertag->layouts[i].boxes);
 	free(m->pertag);
+	free(m->status->title);
+	free(m->status->appid);
+	free(m->status);
 	closemon(m);
 	wlr_scene_node_destroy(&m->fullscreen_bg->node);
 	free(m);
@@ -948,6 +1471,9 @@ commitlayersurfacenotify(struct wl_listener *listener, void *data)
 	struct wlr_scene_tree *scene_layer = layers[layermap[layer_surface->current.layer]];
 	struct wlr_layer_surface_v1_state old_state;
 
+	if (hitchanged(layer_surface->surface))
+		scenegen++;
+
 	if (l->layer_surface->initial_commit) {
 		wlr_fractional_scale_v1_notify_scale(layer_surface->surface, l->mon->wlr_output->scale);
 		wlr_surface_set_preferred_buffer_scale(layer_surface->surface, (int32_t)ceilf(l->mon->wlr_output->scale));
@@ -963,6 +1489,9 @@ commitlayersurfacenotify(struct wl_listener *listener, void *data)
 
 	if (layer_surface->current.committed == 0 && l->mapped == layer_surface->surface->mapped)
 		return;
+	showinhibitors(&l->inhibitors, layer_surface->surface->mapped);
+	if (!l->mapped && layer_surface->surface->mapped)
+		autostartnotify(layer_surface->namespace);
 	l->mapped = layer_surface->surface->mapped;
 
 	if (scene_layer != l->scene->node.parent) {
@@ -979,8 +1508,10 @@ commitlayersurfacenotify(struct wl_listener *listener, void *data)
 void
 commitnotify(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, commit);
+	Client *c = LISTENER_CLIENT(listener, commit);
 
+	if (hitchanged(client_surface(c)))
+		scenegen++;
 	if (c->surface.xdg->initial_commit) {
 		/*
 		 * Get the monitor this client will be rendered on
@@ -996,7 +1527,7 @@ commitnotify(struct wl_listener *listener, void *data)
 		wlr_xdg_toplevel_set_wm_capabilities(c->surface.xdg->toplevel, WLR_XDG_TOPLEVEL_WM_CAPABILITIES_FULLSCREEN);
 		wlr_xdg_toplevel_set_size(c->surface.xdg->toplevel, 0, 0);
 		if (c->decoration)
-			requestdecorationmode(&c->set_decoration_mode, c->decoration);
+			requestdecorationmode(&c->ls->set_decoration_mode, c->decoration);
 		return;
 	}
 
@@ -1004,8 +1535,13 @@ commitnotify(struct wl_listener *listener, void *data)
 		resize(c, c->geom, (c->isfloating && !c->isfullscreen));
 
 	/* mark a pending resize as completed */
-	if (c->resize && c->resize <= c->surface.xdg->current.configure_serial)
+	if (c->resize && c->resize <= c->surface.xdg->current.configure_serial) {
 		c->resize = 0;
+		c->txnlate = 0;
+		/* applygrab() may be waiting for it */
+		if (c == grabc && grabpending && grabmon)
+			wlr_output_schedule_frame(grabmon->wlr_output);
+	}
 }
 
 void
@@ -1035,6 +1571,24 @@ commitpopup(struct wl_listener *listener, void *data)
 	wl_list_remove(&listener->link);
 }
 
+void
+contprocess(pid_t pid)
+{
+	/* Continue pid if hiding one of its windows stopped it */
+	Client *c;
+	int stopped = 0;
+
+	wl_list_for_each(c, &clients, link) {
+		if (c->sigstopped && c->pid == pid) {
+			c->sigstopped = 0;
+			nsigstopped--;
+			stopped = 1;
+		}
+	}
+	if (stopped)
+		kill(pid, SIGCONT);
+}
+
 void
 createdecoration(struct wl_listener *listener, void *data)
 {
@@ -1042,19 +1596,36 @@ createdecoration(struct wl_listener *listener, void *data)
 	Client *c = deco->toplevel->base->data;
 	c->decoration = deco;
 
-	LISTEN(&deco->events.request_mode, &c->set_decoration_mode, requestdecorationmode);
-	LISTEN(&deco->events.destroy, &c->destroy_decoration, destroydecoration);
+	LISTEN(&deco->events.request_mode, &c->ls->set_decoration_mode, requestdecorationmode);
+	LISTEN(&deco->events.destroy, &c->ls->destroy_decoration, destroydecoration);
 
-	requestdecorationmode(&c->set_decoration_mode, deco);
+	requestdecorationmode(&c->ls->set_decoration_mode, deco);
 }
 
 void
 createidleinhibitor(struct wl_listener *listener, void *data)
 {
-	struct wlr_idle_inhibitor_v1 *idle_inhibitor = data;
-	LISTEN_STATIC(&idle_inhibitor->events.destroy, destroyidleinhibitor);
+	IdleInhibitor *inhibitor = ecalloc(1, sizeof(*inhibitor));
+	Client *c = NULL;
+	LayerSurface *l = NULL;
 
-	checkidleinhibitor(NULL);
+	inhibitor->inhibitor = data;
+	LISTEN(&inhibitor->inhibitor->events.destroy, &inhibitor->destroy, destroyidleinhibitor);
+	wl_list_insert(&inhibitors, &inhibitor->link);
+
+	/* Counted while the window or layer surface it belongs to is shown */
+	if (!bypass_surface_visibility
+			&& toplevel_from_wlr_surface(inhibitor->inhibitor->surface, &c, &l) >= 0
+			&& (c || l)) {
+		inhibitor->owner = c ? &c->inhibitors : &l->inhibitors;
+		inhibitor->owner->n++;
+		nvisibleinhibitors += inhibitor->owner->shown;
+	} else {
+		inhibitor->visible = bypass_surface_visibility
+				|| wlr_surface_get_root_surface(inhibitor->inhibitor->surface)->mapped;
+		nvisibleinhibitors += inhibitor->visible;
+	}
+	wlr_idle_notifier_v1_set_inhibited(idle_notifier, nvisibleinhibitors > 0);
 }
 
 void
@@ -1118,7 +1689,7 @@ createlayersurface(struct wl_listener *listener, void *data)
 		return;
 	}
 
-	l = layer_surface->data = ecalloc(1, sizeof(*l));
+	l = layer_surface->data = poolalloc(&layerpool);
 	l->type = LayerShell;
 	LISTEN(&surface->events.commit, &l->surface_commit, commitlayersurfacenotify);
 	LISTEN(&surface->events.unmap, &l->unmap, unmaplayersurfacenotify);
@@ -1173,6 +1744,10 @@ createmon(struct wl_listener *listener, void *data)
 	m->wlr_output = wlr_output;
 
 	wl_list_init(&m->dwl_ipc_outputs);
+	wl_list_init(&m->tiled);
+	wl_list_init(&m->floating);
+	wl_list_init(&m->fullscreen);
+	m->txn_timer = wl_event_loop_add_timer(event_loop, txntimeout, m);
 
 	for (i = 0; i < LENGTH(m->layers); i++)
 		wl_list_init(&m->layers[i]);
@@ -1216,9 +1791,11 @@ createmon(struct wl_listener *listener, void *data)
 	wlr_output_state_finish(&state);
 
 	wl_list_insert(&mons, &m->link);
+	indexmons();
 	printstatus();
 
 	m->pertag = calloc(1, sizeof(Pertag));
+	m->status = ecalloc(1, sizeof(*m->status));
 	m->pertag->curtag = m->pertag->prevtag = 1;
 
 	for (i = 0; i <= TAGCOUNT; i++) {
@@ -1263,17 +1840,21 @@ createnotify(struct wl_listener *listener, void *data)
 	Client *c = NULL;
 
 	/* Allocate a Client for this surface */
-	c = toplevel->base->data = ecalloc(1, sizeof(*c));
+	c = toplevel->base->data = poolalloc(&clientpool);
+	c->ls = poolalloc(&listenerpool);
+	c->ls->c = c;
 	c->surface.xdg = toplevel->base;
 	c->bw = borderpx;
+	wl_list_init(&c->vlink);
+	wl_list_init(&c->titlelink);
 
-	LISTEN(&toplevel->base->surface->events.commit, &c->commit, commitnotify);
-	LISTEN(&toplevel->base->surface->events.map, &c->map, mapnotify);
-	LISTEN(&toplevel->base->surface->events.unmap, &c->unmap, unmapnotify);
-	LISTEN(&toplevel->events.destroy, &c->destroy, destroynotify);
-	LISTEN(&toplevel->events.request_fullscreen, &c->fullscreen, fullscreennotify);
-	LISTEN(&toplevel->events.request_maximize, &c->maximize, maximizenotify);
-	LISTEN(&toplevel->events.set_title, &c->set_title, updatetitle);
+	LISTEN(&toplevel->base->surface->events.commit, &c->ls->commit, commitnotify);
+	LISTEN(&toplevel->base->surface->events.map, &c->ls->map, mapnotify);
+	LISTEN(&toplevel->base->surface->events.unmap, &c->ls->unmap, unmapnotify);
+	LISTEN(&toplevel->events.destroy, &c->ls->destroy, destroynotify);
+	LISTEN(&toplevel->events.request_fullscreen, &c->ls->fullscreen, fullscreennotify);
+	LISTEN(&toplevel->events.request_maximize, &c->ls->maximize, maximizenotify);
+	LISTEN(&toplevel->events.set_title, &c->ls->set_title, updatetitle);
 }
 
 void
@@ -1323,10 +1904,17 @@ createpointer(struct wlr_pointer *pointer)
 void
 createpointerconstraint(struct wl_listener *listener, void *data)
 {
-	PointerConstraint *pointer_constraint = ecalloc(1, sizeof(*pointer_constraint));
-	pointer_constraint->constraint = data;
+	PointerConstraint *pointer_constraint = poolalloc(&constraintpool);
+	struct wlr_pointer_constraint_v1 *constraint = data;
+
+	pointer_constraint->constraint = constraint;
 	LISTEN(&pointer_constraint->constraint->events.destroy,
 			&pointer_constraint->destroy, destroypointerconstraint);
+	wl_list_insert(&constrainttab[(uintptr_t)constraint->surface / 8 % LENGTH(constrainttab)],
+			&pointer_constraint->link);
+
+	if (constraint->surface == seat->pointer_state.focused_surface)
+		cursorconstrain(constraint);
 }
 
 void
@@ -1338,6 +1926,20 @@ createpopup(struct wl_listener *listener, void *data)
 	LISTEN_STATIC(&popup->base->surface->events.commit, commitpopup);
 }
 
+struct wlr_pointer_constraint_v1 *
+constraintat(struct wlr_surface *surface)
+{
+	PointerConstraint *p;
+
+	if (!surface)
+		return NULL;
+	wl_list_for_each(p, &constrainttab[(uintptr_t)surface / 8 % LENGTH(constrainttab)], link) {
+		if (p->constraint->surface == surface && p->constraint->seat == seat)
+			return p->constraint;
+	}
+	return NULL;
+}
+
 void
 cursorconstrain(struct wlr_pointer_constraint_v1 *constraint)
 {
@@ -1348,7 +1950,8 @@ cursorconstrain(struct wlr_pointer_constraint_v1 *constraint)
 		wlr_pointer_constraint_v1_send_deactivated(active_constraint);
 
 	active_constraint = constraint;
-	wlr_pointer_constraint_v1_send_activated(constraint);
+	if (constraint)
+		wlr_pointer_constraint_v1_send_activated(constraint);
 }
 
 void
@@ -1358,8 +1961,11 @@ cursorframe(struct wl_listener *listener, void *data)
 	 * event. Frame events are sent after regular pointer events to group
 	 * multiple events together. For instance, two axis events may happen at the
 	 * same time, in which case a frame event won't be sent in between. */
-	/* Notify the client with pointer focus of the frame event. */
-	wlr_seat_pointer_notify_frame(seat);
+	/* Notify the client with pointer focus of the frame event, unless all
+	 * it got was postponed, see flushmotion() */
+	if (framepending)
+		wlr_seat_pointer_notify_frame(seat);
+	framepending = 0;
 }
 
 void
@@ -1385,46 +1991,21 @@ defaultgaps(const Arg *arg)
 void
 deck(Monitor *m)
 {
-	unsigned int mw, my;
-	int i, n = 0;
 	Client *c;
 
-	wl_list_for_each(c, &clients, link)
-		if (VISIBLEON(c, m) && !c->isfloating && !c->isfullscreen)
-			n++;
-	if (n == 0)
-		return;
-
-	if (n > m->nmaster)
-		mw = m->nmaster ? (int)round(m->w.width * m->mfact) : 0;
-	else
-		mw = m->w.width;
-	i = my = 0;
-	wl_list_for_each(c, &clients, link) {
-		if (!VISIBLEON(c, m) || c->isfloating || c->isfullscreen)
-			continue;
-		if (i < m->nmaster) {
-			resize(c, (struct wlr_box){.x = m->w.x, .y = m->w.y + my, .width = mw,
-				.height = (m->w.height - my) / (MIN(n, m->nmaster) - i)}, 0);
-			my += c->geom.height;
-		} else {
-			resize(c, (struct wlr_box){.x = m->w.x + mw, .y = m->w.y,
-				.width = m->w.width - mw, .height = m->w.height}, 0);
-			if (c == focustop(m))
-				wlr_scene_node_raise_to_top(&c->scene->node);
-		}
-		i++;
-	}
+	applylayout(m, deckgeom, (LayoutParams){.mfact = m->mfact, .nmaster = m->nmaster});
+	if ((c = focustop(m)))
+		wlr_scene_node_raise_to_top(&c->scene->node);
 }
 
 void
 destroydecoration(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, destroy_decoration);
+	Client *c = LISTENER_CLIENT(listener, destroy_decoration);
 	c->decoration = NULL;
 
-	wl_list_remove(&c->destroy_decoration.link);
-	wl_list_remove(&c->set_decoration_mode.link);
+	wl_list_remove(&c->ls->destroy_decoration.link);
+	wl_list_remove(&c->ls->set_decoration_mode.link);
 }
 
 void
@@ -1435,12 +2016,29 @@ destroydragicon(struct wl_listener *listener, void *data)
 	motionnotify(0, NULL, 0, 0, 0, 0);
 }
 
+void
+destroyhitnode(struct wl_listener *listener, void *data)
+{
+	wl_list_remove(&hitcache.destroy.link);
+	hitcache.node = NULL;
+	hitcache.gen = 0;
+}
+
 void
 destroyidleinhibitor(struct wl_listener *listener, void *data)
 {
-	/* `data` is the wlr_surface of the idle inhibitor being destroyed,
-	 * at this point the idle inhibitor is still in the list of the manager */
-	checkidleinhibitor(wlr_surface_get_root_surface(data));
+	IdleInhibitor *inhibitor = wl_container_of(listener, inhibitor, destroy);
+
+	if (inhibitor->owner) {
+		inhibitor->owner->n--;
+		nvisibleinhibitors -= inhibitor->owner->shown;
+	} else {
+		nvisibleinhibitors -= inhibitor->visible;
+	}
+	wlr_idle_notifier_v1_set_inhibited(idle_notifier, nvisibleinhibitors > 0);
+	wl_list_remove(&inhibitor->destroy.link);
+	wl_list_remove(&inhibitor->link);
+	free(inhibitor);
 }
 
 void
@@ -1470,9 +2068,10 @@ destroylayersurfacenotify(struct wl_listener *listener, void *data)
 	wl_list_remove(&l->destroy.link);
 	wl_list_remove(&l->unmap.link);
 	wl_list_remove(&l->surface_commit.link);
+	detachinhibitors(&l->inhibitors);
 	wlr_scene_node_destroy(&l->scene->node);
 	wlr_scene_node_destroy(&l->popups->node);
-	free(l);
+	poolfree(&layerpool, l);
 }
 
 void
@@ -1523,25 +2122,29 @@ void
 destroynotify(struct wl_listener *listener, void *data)
 {
 	/* Called when the xdg_toplevel is destroyed. */
-	Client *c = wl_container_of(listener, c, destroy);
-	wl_list_remove(&c->destroy.link);
-	wl_list_remove(&c->set_title.link);
-	wl_list_remove(&c->fullscreen.link);
+	Client *c = LISTENER_CLIENT(listener, destroy);
+	wl_list_remove(&c->ls->destroy.link);
+	wl_list_remove(&c->ls->set_title.link);
+	wl_list_remove(&c->titlelink);
+	wl_list_remove(&c->ls->fullscreen.link);
 #ifdef XWAYLAND
 	if (c->type != XDGShell) {
-		wl_list_remove(&c->activate.link);
-		wl_list_remove(&c->associate.link);
-		wl_list_remove(&c->configure.link);
-		wl_list_remove(&c->dissociate.link);
-		wl_list_remove(&c->set_hints.link);
+		wl_list_remove(&c->ls->activate.link);
+		wl_list_remove(&c->ls->associate.link);
+		wl_list_remove(&c->ls->configure.link);
+		wl_list_remove(&c->ls->dissociate.link);
+		wl_list_remove(&c->ls->set_hints.link);
 	} else
 #endif
 	{
-		wl_list_remove(&c->commit.link);
-		wl_list_remove(&c->map.link);
-		wl_list_remove(&c->unmap.link);
+		wl_list_remove(&c->ls->commit.link);
+		wl_list_remove(&c->ls->map.link);
+		wl_list_remove(&c->ls->unmap.link);
 	}
-	free(c);
+	detachinhibitors(&c->inhibitors);
+	free(c->title);
+	poolfree(&listenerpool, c->ls);
+	poolfree(&clientpool, c);
 }
 
 void
@@ -1555,7 +2158,8 @@ destroypointerconstraint(struct wl_listener *listener, void *data)
 	}
 
 	wl_list_remove(&pointer_constraint->destroy.link);
-	free(pointer_constraint);
+	wl_list_remove(&pointer_constraint->link);
+	poolfree(&constraintpool, pointer_constraint);
 }
 
 void
@@ -1584,6 +2188,21 @@ destroykeyboardgroup(struct wl_listener *listener, void *data)
 	free(group);
 }
 
+void
+detachinhibitors(InhibitorCount *ic)
+{
+	/* The owner of ic is destroyed before its inhibitors */
+	IdleInhibitor *inhibitor;
+
+	showinhibitors(ic, 0);
+	if (!ic->n)
+		return;
+	wl_list_for_each(inhibitor, &inhibitors, link) {
+		if (inhibitor->owner == ic)
+			inhibitor->owner = NULL;
+	}
+}
+
 Monitor *
 dirtomon(enum wlr_direction dir)
 {
@@ -1631,12 +2250,16 @@ dwl_ipc_manager_get_output(struct wl_client *client, struct wl_resource *resourc
 	if (!output_resource)
 		return;
 
-	ipc_output = ecalloc(1, sizeof(*ipc_output));
+	ipc_output = poolalloc(&ipcoutputpool);
 	ipc_output->resource = output_resource;
 	ipc_output->mon = monitor;
 	wl_resource_set_implementation(output_resource, &dwl_output_implementation, ipc_output, dwl_ipc_output_destroy);
 	wl_list_insert(&monitor->dwl_ipc_outputs, &ipc_output->link);
-	dwl_ipc_output_printstatus_to(ipc_output);
+	/* Bring everyone up to date if a change is still pending */
+	if (dwl_ipc_output_status_update(monitor))
+		dwl_ipc_output_printstatus(monitor);
+	else
+		dwl_ipc_output_printstatus_to(ipc_output);
 }
 
 void
@@ -1650,7 +2273,12 @@ dwl_ipc_output_destroy(struct wl_resource *resource)
 {
 	DwlIpcOutput *ipc_output = wl_resource_get_user_data(resource);
 	wl_list_remove(&ipc_output->link);
-	free(ipc_output);
+	if (ipc_output->sent) {
+		free(ipc_output->sent->title);
+		free(ipc_output->sent->appid);
+		free(ipc_output->sent);
+	}
+	poolfree(&ipcoutputpool, ipc_output);
 }
 
 void
@@ -1664,47 +2292,89 @@ dwl_ipc_output_printstatus(Monitor *monitor)
 void
 dwl_ipc_output_printstatus_to(DwlIpcOutput *ipc_output)
 {
-	Monitor *monitor = ipc_output->mon;
-	Client *c, *focused;
-	int tagmask, state, numclients, focused_client, tag;
-	const char *title, *appid;
-	focused = focustop(monitor);
-	zdwl_ipc_output_v2_send_active(ipc_output->resource, monitor == selmon);
+	/* Version 3 subscribers only get the events whose state differs from
+	 * what was last sent to them, older ones always get everything */
+	IpcStatus *st = ipc_output->mon->status, *sent = ipc_output->sent;
+	struct wl_resource *resource = ipc_output->resource;
+	int version = wl_resource_get_version(resource);
+	int full = version < ZDWL_IPC_OUTPUT_V2_CHANGES_SINCE_VERSION || !sent;
+	int state, sentstate, tag;
+	uint32_t tagmask, changes = 0;
+
+	if (full || st->active != sent->active) {
+		zdwl_ipc_output_v2_send_active(resource, st->active);
+		changes |= ZDWL_IPC_OUTPUT_V2_CHANGE_ACTIVE;
+	}
 
 	for (tag = 0 ; tag < TAGCOUNT; tag++) {
-		numclients = state = focused_client = 0;
 		tagmask = 1 << tag;
-		if ((tagmask & monitor->tagset[monitor->seltags]) != 0)
-			state |= ZDWL_IPC_OUTPUT_V2_TAG_STATE_ACTIVE;
-
-		wl_list_for_each(c, &clients, link) {
-			if (c->mon != monitor)
-				continue;
-			if (!(c->tags & tagmask))
+		state = ((st->tagset & tagmask) ? ZDWL_IPC_OUTPUT_V2_TAG_STATE_ACTIVE : 0)
+			| ((st->urgent & tagmask) ? ZDWL_IPC_OUTPUT_V2_TAG_STATE_URGENT : 0);
+		if (!full) {
+			sentstate = ((sent->tagset & tagmask) ? ZDWL_IPC_OUTPUT_V2_TAG_STATE_ACTIVE : 0)
+				| ((sent->urgent & tagmask) ? ZDWL_IPC_OUTPUT_V2_TAG_STATE_URGENT : 0);
+			if (state == sentstate && st->nclients[tag] == sent->nclients[tag]
+					&& !(st->focused & tagmask) == !(sent->focused & tagmask))
 				continue;
-			if (c == focused)
-				focused_client = 1;
-			if (c->isurgent)
-				state |= ZDWL_IPC_OUTPUT_V2_TAG_STATE_URGENT;
-
-			numclients++;
 		}
-		zdwl_ipc_output_v2_send_tag(ipc_output->resource, tag, state, numclients, focused_client);
+		zdwl_ipc_output_v2_send_tag(resource, tag, state,
+				st->nclients[tag], !!(st->focused & tagmask));
+		changes |= ZDWL_IPC_OUTPUT_V2_CHANGE_TAG;
 	}
-	title = focused ? client_get_title(focused) : "";
-	appid = focused ? client_get_appid(focused) : "";
 
-	zdwl_ipc_output_v2_send_layout(ipc_output->resource, monitor->lt[monitor->sellt] - layouts);
-	zdwl_ipc_output_v2_send_title(ipc_output->resource, title);
-	zdwl_ipc_output_v2_send_appid(ipc_output->resource, appid);
-	zdwl_ipc_output_v2_send_layout_symbol(ipc_output->resource, monitor->ltsymbol);
-	if (wl_resource_get_version(ipc_output->resource) >= ZDWL_IPC_OUTPUT_V2_FULLSCREEN_SINCE_VERSION) {
-		zdwl_ipc_output_v2_send_fullscreen(ipc_output->resource, focused ? focused->isfullscreen : 0);
+	if (full || st->layout != sent->layout) {
+		zdwl_ipc_output_v2_send_layout(resource, st->layout);
+		changes |= ZDWL_IPC_OUTPUT_V2_CHANGE_LAYOUT;
+	}
+	if (full || strcmp(st->title, sent->title)) {
+		zdwl_ipc_output_v2_send_title(resource, st->title);
+		changes |= ZDWL_IPC_OUTPUT_V2_CHANGE_TITLE;
+	}
+	if (full || strcmp(st->appid, sent->appid)) {
+		zdwl_ipc_output_v2_send_appid(resource, st->appid);
+		changes |= ZDWL_IPC_OUTPUT_V2_CHANGE_APPID;
+	}
+	if (full || strncmp(st->ltsymbol, sent->ltsymbol, LENGTH(st->ltsymbol))) {
+		zdwl_ipc_output_v2_send_layout_symbol(resource, st->ltsymbol);
+		changes |= ZDWL_IPC_OUTPUT_V2_CHANGE_LAYOUT_SYMBOL;
+	}
+	if (version >= ZDWL_IPC_OUTPUT_V2_FULLSCREEN_SINCE_VERSION
+			&& (full || st->fullscreen != sent->fullscreen)) {
+		zdwl_ipc_output_v2_send_fullscreen(resource, st->fullscreen);
+		changes |= ZDWL_IPC_OUTPUT_V2_CHANGE_FULLSCREEN;
+	}
+	if (version >= ZDWL_IPC_OUTPUT_V2_FLOATING_SINCE_VERSION
+			&& (full || st->floating != sent->floating)) {
+		zdwl_ipc_output_v2_send_floating(resource, st->floating);
+		changes |= ZDWL_IPC_OUTPUT_V2_CHANGE_FLOATING;
 	}
-	if (wl_resource_get_version(ipc_output->resource) >= ZDWL_IPC_OUTPUT_V2_FLOATING_SINCE_VERSION) {
-		zdwl_ipc_output_v2_send_floating(ipc_output->resource, focused ? focused->isfloating : 0);
+
+	if (version >= ZDWL_IPC_OUTPUT_V2_CHANGES_SINCE_VERSION) {
+		if (!changes)
+			return;
+		zdwl_ipc_output_v2_send_changes(resource, ++ipc_output->seq, changes);
+
+		if (!sent)
+			sent = ipc_output->sent = ecalloc(1, sizeof(*sent));
+		if (changes & ZDWL_IPC_OUTPUT_V2_CHANGE_TITLE) {
+			free(sent->title);
+			sent->title = strdup(st->title);
+		}
+		if (changes & ZDWL_IPC_OUTPUT_V2_CHANGE_APPID) {
+			free(sent->appid);
+			sent->appid = strdup(st->appid);
+		}
+		sent->active = st->active;
+		sent->tagset = st->tagset;
+		sent->urgent = st->urgent;
+		sent->focused = st->focused;
+		memcpy(sent->nclients, st->nclients, sizeof(sent->nclients));
+		sent->layout = st->layout;
+		memcpy(sent->ltsymbol, st->ltsymbol, sizeof(sent->ltsymbol));
+		sent->fullscreen = st->fullscreen;
+		sent->floating = st->floating;
 	}
-	zdwl_ipc_output_v2_send_frame(ipc_output->resource);
+	zdwl_ipc_output_v2_send_frame(resource);
 }
 
 void
@@ -1729,6 +2399,7 @@ dwl_ipc_output_set_client_tags(struct wl_client *client, struct wl_resource *res
 		return;
 
 	selected_client->tags = newtags;
+	reindex(selected_client);
 	if (selmon == monitor)
 		focusclient(focustop(monitor), 1);
 	arrange(selmon);
@@ -1764,6 +2435,58 @@ dwl_ipc_output_set_layout(struct wl_client *client, struct wl_resource *resource
 	}
 }
 
+int
+dwl_ipc_output_status_update(Monitor *monitor)
+{
+	/* Recompute the status of monitor in a single pass over the clients,
+	 * returns 1 if it differs from what was sent last */
+	IpcStatus *st = monitor->status, new = {0};
+	Client *c, *focused = focustop(monitor);
+	const char *title = NULL, *appid = NULL;
+	uint32_t t;
+	int tag;
+
+	new.active = monitor == selmon;
+	new.tagset = monitor->tagset[monitor->seltags];
+	wl_list_for_each(c, &clients, link) {
+		if (c->mon != monitor)
+			continue;
+		if (c->isurgent)
+			new.urgent |= c->tags;
+		for (t = c->tags & TAGMASK, tag = 0; t; t >>= 1, tag++)
+			new.nclients[tag] += t & 1;
+	}
+	if (focused) {
+		new.focused = focused->tags;
+		new.fullscreen = focused->isfullscreen;
+		new.floating = focused->isfloating;
+		title = client_get_title(focused);
+		appid = client_get_appid(focused);
+	}
+	new.layout = monitor->lt[monitor->sellt] - layouts;
+	strncpy(new.ltsymbol, monitor->ltsymbol, LENGTH(new.ltsymbol));
+	title = title ? title : "";
+	appid = appid ? appid : "";
+
+	if (st->title && new.active == st->active && new.tagset == st->tagset
+			&& new.urgent == st->urgent && new.focused == st->focused
+			&& new.layout == st->layout && new.fullscreen == st->fullscreen
+			&& new.floating == st->floating
+			&& !memcmp(new.nclients, st->nclients, sizeof(new.nclients))
+			&& !strncmp(new.ltsymbol, st->ltsymbol, LENGTH(new.ltsymbol))
+			&& !strcmp(title, st->title) && !strcmp(appid, st->appid))
+		return 0;
+
+	new.title = st->title && !strcmp(st->title, title) ? st->title : strdup(title);
+	new.appid = st->appid && !strcmp(st->appid, appid) ? st->appid : strdup(appid);
+	if (new.title != st->title)
+		free(st->title);
+	if (new.appid != st->appid)
+		free(st->appid);
+	*st = new;
+	return 1;
+}
+
 void
 dwl_ipc_output_set_tags(struct wl_client *client, struct wl_resource *resource, uint32_t tagmask, uint32_t toggle_tagset)
 {
@@ -1806,6 +2529,42 @@ dwl_ipc_output_release(struct wl_client *client, struct wl_resource *resource)
 	wl_resource_destroy(resource);
 }
 
+Proc *
+findproc(pid_t pid)
+{
+	Proc *p;
+
+	wl_list_for_each(p, &proctab[pid % LENGTH(proctab)], link) {
+		if (p->pid == pid)
+			return p;
+	}
+	return NULL;
+}
+
+void
+flushmotion(void)
+{
+	struct wlr_surface *surface = motionsurface;
+
+	motionsurface = NULL;
+	if (surface && surface == seat->pointer_state.focused_surface) {
+		wlr_seat_pointer_notify_motion(seat, motiontime, motionsx, motionsy);
+		wlr_seat_pointer_notify_frame(seat);
+		framepending = 0;
+	}
+}
+
+void
+flushtitles(Monitor *m)
+{
+	Client *c, *tmp;
+
+	wl_list_for_each_safe(c, tmp, &titles, titlelink) {
+		if (c->mon == m)
+			propagatetitle(c);
+	}
+}
+
 void
 focusclient(Client *c, int lift)
 {
@@ -1816,6 +2575,7 @@ focusclient(Client *c, int lift)
 
 	if (locked)
 		return;
+	scenegen++;
 
 	/* Raise client in stacking order if requested */
 	if (c && lift)
@@ -1913,6 +2673,7 @@ focusortogglematchingscratch(const Arg *arg)
 				if (found == 1) {
 					if (hide == 1) {
 						c->tags = 0;
+						reindex(c);
 						focusclient(focustop(selmon), 1);
 					}
 					continue;
@@ -1920,6 +2681,7 @@ focusortogglematchingscratch(const Arg *arg)
 				if (focustop(selmon) == c) {
 					// hide
 					c->tags = 0;
+					reindex(c);
 					focusclient(focustop(selmon), 1);
 					hide = 1;
 				} else {
@@ -1929,6 +2691,7 @@ focusortogglematchingscratch(const Arg *arg)
 			} else {
 				// show
 				c->tags = selmon->tagset[selmon->seltags];
+				reindex(c);
 				// focus
 				focusclient(c, 1);
 			}
@@ -1938,6 +2701,7 @@ focusortogglematchingscratch(const Arg *arg)
 		if (VISIBLEON(c, selmon)) {
 			// hide
 			c->tags = 0;
+			reindex(c);
 		}
 	}
 
@@ -1966,6 +2730,7 @@ focusortogglescratch(const Arg *arg)
 			if (focustop(selmon) == c) {
 				// hide
 				c->tags = 0;
+				reindex(c);
 				focusclient(focustop(selmon), 1);
 			} else {
 				// focus
@@ -1974,6 +2739,7 @@ focusortogglescratch(const Arg *arg)
 		} else {
 			// show
 			c->tags = selmon->tagset[selmon->seltags];
+			reindex(c);
 			focusclient(c, 1);
 		}
 		arrange(selmon);
@@ -2058,6 +2824,9 @@ Client *
 focustop(Monitor *m)
 {
 	Client *c;
+	if (!m || (wl_list_empty(&m->tiled) && wl_list_empty(&m->floating)
+			&& wl_list_empty(&m->fullscreen)))
+		return NULL;
 	wl_list_for_each(c, &fstack, flink) {
 		if (VISIBLEON(c, m))
 			return c;
@@ -2068,7 +2837,7 @@ focustop(Monitor *m)
 void
 fullscreennotify(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, fullscreen);
+	Client *c = LISTENER_CLIENT(listener, fullscreen);
 	setfullscreen(c, client_wants_fullscreen(c));
 }
 
@@ -2099,86 +2868,72 @@ gpureset(struct wl_listener *listener, void *data)
 void
 handlesig(int signo)
 {
-	if (signo == SIGCHLD) {
-		siginfo_t in;
-		/* wlroots expects to reap the XWayland process itself, so we
-		 * use WNOWAIT to keep the child waitable until we know it's not
-		 * XWayland.
-		 */
-		while (!waitid(P_ALL, 0, &in, WEXITED|WNOHANG|WNOWAIT) && in.si_pid
-#ifdef XWAYLAND
-			   && (!xwayland || in.si_pid != xwayland->server->pid)
-#endif
-			   ) {
-			pid_t *p, *lim;
-			waitpid(in.si_pid, NULL, 0);
-			if (in.si_pid == child_pid)
-				child_pid = -1;
-			if (!(p = autostart_pids))
-				continue;
-			lim = &p[autostart_len];
-
-			for (; p < lim; p++) {
-				if (*p == in.si_pid) {
-					*p = -1;
-					break;
-				}
-			}
-		}
-	} else if (signo == SIGINT || signo == SIGTERM) {
+	if (signo == SIGINT || signo == SIGTERM)
 		quit(NULL);
-	}
 }
 
 void
-gaplessgrid(Monitor *m)
+hashbindings(void)
 {
-	unsigned int n = 0, i = 0, ch, cw, cn, rn, rows, cols;
-	Client *c;
+	/* Chain the bindings in reverse so that lookups still find the first
+	 * matching entry of keys and buttons */
+	unsigned int i, h;
 
-	wl_list_for_each(c, &clients, link)
-		if (VISIBLEON(c, m) && !c->isfloating)
-			n++;
-	if (n == 0)
-		return;
+	for (i = LENGTH(keys); i > 0; i--) {
+		if (!keys[i - 1].func)
+			continue;
+		h = bindhash(keys[i - 1].mod, keys[i - 1].keysym);
+		keynext[i - 1] = keyhead[h];
+		keyhead[h] = i;
+	}
+	for (i = LENGTH(buttons); i > 0; i--) {
+		if (!buttons[i - 1].func)
+			continue;
+		h = bindhash(buttons[i - 1].mod, buttons[i - 1].button);
+		buttonnext[i - 1] = buttonhead[h];
+		buttonhead[h] = i;
+	}
+}
 
-	/* grid dimensions */
-	for (cols = 0; cols <= (n / 2); cols++)
-		if ((cols * cols) >= n)
-			break;
+void
+gaplessgrid(Monitor *m)
+{
+	applylayout(m, gaplessgridgeom, (LayoutParams){0});
+}
 
-	if (n == 5) /* set layout against the general calculation: not 1:2:2, but 2:3 */
-		cols = 2;
+void
+hideclient(Client *c, int hide)
+{
+	/* Throttle c while it is on a hidden tag, how much depends on its rule.
+	 * Called before its scene node is enabled or disabled. */
+	client_set_suspended(c, hide);
+	if (c->hidden >= HideThrottle)
+		client_set_minimized(c, hide);
 
-    /* widescreen is better if 3 columns */
-	if (n >= 3 && n <= 6 && (m->w.width / m->w.height) > 1) {
-		cols = 3;
+	if (!hide) {
+		if (c->stop_timer)
+			wl_event_source_timer_update(c->stop_timer, 0);
+		/* whatever c's policy, a window of its process with HideStop may
+		 * have stopped it */
+		if (nsigstopped)
+			contprocess(client_get_pid(c));
+		return;
 	}
+	if (c->hidden < HideStop)
+		return;
+	if (!c->stop_timer)
+		c->stop_timer = wl_event_loop_add_timer(event_loop, stophidden, c);
+	wl_event_source_timer_update(c->stop_timer, hidden_stop_delay * 1000);
+}
 
-	rows = n / cols;
-    
-	/* window geometries */
-	cw = cols ? m->w.width / cols : (unsigned int)m->w.width;
-	cn = 0; /* current column number */
-	rn = 0; /* current row number */
-	wl_list_for_each(c, &clients, link) {
-		unsigned int cx, cy;
-		if (!VISIBLEON(c, m) || c->isfloating || c->isfullscreen)
-			continue;
-
-		if ((i / rows + 1) > (cols - n % cols))
-			rows = n / cols + 1;
-		ch = rows ? m->w.height / rows : (unsigned int)m->w.height;
-		cx = m->w.x + cn * cw;
-		cy = m->w.y + rn * ch;
-		resize(c, (struct wlr_box) { cx, cy, cw, ch}, 0);
-		rn++;
-		if (rn >= rows) {
-			rn = 0;
-			cn++;
-		}
-		i++;
-	}
+int
+hitchanged(struct wlr_surface *surface)
+{
+	/* Whether a commit can move what xytonode() finds under the cursor */
+	return (surface->current.committed
+			& (WLR_SURFACE_STATE_INPUT_REGION | WLR_SURFACE_STATE_OFFSET))
+		|| surface->current.width != surface->previous.width
+		|| surface->current.height != surface->previous.height;
 }
 
 void
@@ -2190,6 +2945,21 @@ incnmaster(const Arg *arg)
 	arrange(selmon);
 }
 
+void
+indexmons(void)
+{
+	/* Resolve Rule.monitor indices once per output change instead of on
+	 * every rule match */
+	Monitor *m;
+	int i = 0;
+
+	free(monindex);
+	monindex = ecalloc(wl_list_length(&mons) + 1, sizeof(*monindex));
+	wl_list_for_each(m, &mons, link)
+		monindex[i++] = m;
+	nmonindex = i;
+}
+
 void
 incgaps(const Arg *arg)
 {
@@ -2306,9 +3076,10 @@ keybinding(uint32_t mods, xkb_keysym_t sym)
 	 * processing.
 	 */
 	const Key *k;
-	for (k = keys; k < END(keys); k++) {
-		if (CLEANMASK(mods) == CLEANMASK(k->mod)
-				&& sym == k->keysym && k->func) {
+	unsigned int i;
+	for (i = keyhead[bindhash(mods, sym)]; i; i = keynext[i - 1]) {
+		k = &keys[i - 1];
+		if (CLEANMASK(mods) == CLEANMASK(k->mod) && sym == k->keysym) {
 			k->func(&k->arg);
 			return 1;
 		}
@@ -2407,6 +3178,7 @@ locksession(struct wl_listener *listener, void *data)
 	struct wlr_session_lock_v1 *session_lock = data;
 	SessionLock *lock;
 	wlr_scene_node_set_enabled(&locked_bg->node, 1);
+	scenegen++;
 	if (cur_lock) {
 		wlr_session_lock_v1_destroy(session_lock);
 		return;
@@ -2422,7 +3194,20 @@ locksession(struct wl_listener *listener, void *data)
 	LISTEN(&session_lock->events.destroy, &lock->destroy, destroysessionlock);
 	LISTEN(&session_lock->events.unlock, &lock->unlock, unlocksession);
 
-	wlr_session_lock_v1_send_locked(session_lock);
+	wlr_session_lock_v1_send_locked(session_lock);
+}
+
+int
+logstats(int signo, void *data)
+{
+	Pool *const *p;
+
+	for (p = pools; p < END(pools); p++)
+		wlr_log(WLR_INFO, "pool %s: %zu live, %zu peak, %zu bytes in %zu slabs",
+				(*p)->name, (*p)->live, (*p)->peak, poolbytes(*p), (*p)->nslabs);
+	wlr_log(WLR_INFO, "spawn: %lu processes, last %ld us, max %ld us",
+			nspawned, spawnlatency, spawnlatencymax);
+	return 0;
 }
 
 void
@@ -2430,14 +3215,16 @@ mapnotify(struct wl_listener *listener, void *data)
 {
 	/* Called when the surface is mapped, or ready to display on-screen. */
 	Client *p = NULL;
-	Client *w, *c = wl_container_of(listener, c, map);
+	Client *w, *c = LISTENER_CLIENT(listener, map);
 	Monitor *m;
-	int i;
 	struct wlr_box b;
 
 	/* Create scene tree for this client and its border */
 	c->scene = client_surface(c)->data = wlr_scene_tree_create(layers[LyrTile]);
 	wlr_scene_node_set_enabled(&c->scene->node, c->type != XDGShell);
+	/* a new scene tree, make resize() set it up */
+	c->applied = c->clip = (struct wlr_box){0};
+	showinhibitors(&c->inhibitors, c->scene->node.enabled);
 	c->scene_surface = c->type == XDGShell
 			? wlr_scene_xdg_surface_create(c->scene, c->surface.xdg)
 			: wlr_scene_subsurface_tree_create(c->scene, client_surface(c));
@@ -2457,11 +3244,8 @@ mapnotify(struct wl_listener *listener, void *data)
 		goto unset_fullscreen;
 	}
 
-	for (i = 0; i < 4; i++) {
-		c->border[i] = wlr_scene_rect_create(c->scene, 0, 0,
-				c->isurgent ? urgentcolor : bordercolor);
-		c->border[i]->node.data = c;
-	}
+	c->border[0] = NULL;
+	c->bordercolor = c->isurgent ? urgentcolor : bordercolor;
 
 	createforeigntoplevel(c);
 
@@ -2477,6 +3261,8 @@ mapnotify(struct wl_listener *listener, void *data)
 	else
 		wl_list_insert(&clients, &c->link);
 	wl_list_insert(&fstack, &c->flink);
+	client_poll_stopped(c);
+	autostartnotify(client_get_appid(c));
 
 	/* Set initial monitor, tags, floating status, and focus:
 	 * we always consider floating, clients that have parent and thus
@@ -2508,6 +3294,7 @@ unset_fullscreen:
 		if (w != c && w != p && w->isfullscreen && m == w->mon && (w->tags & c->tags))
 			setfullscreen(w, 0);
 	}
+	benchmapped(m);
 }
 
 void
@@ -2521,7 +3308,7 @@ maximizenotify(struct wl_listener *listener, void *data)
 	 * capabilities, just schedule a empty configure when the client uses <5
 	 * protocol version
 	 * wlr_xdg_surface_schedule_configure() is used to send an empty reply. */
-	Client *c = wl_container_of(listener, c, maximize);
+	Client *c = LISTENER_CLIENT(listener, maximize);
 	if (c->surface.xdg->initialized
 			&& wl_resource_get_version(c->surface.xdg->toplevel->resource)
 					< XDG_TOPLEVEL_WM_CAPABILITIES_SINCE_VERSION)
@@ -2532,18 +3319,11 @@ void
 monocle(Monitor *m)
 {
 	Client *c;
-	int n = 0;
+	int n = wl_list_length(&m->tiled);
 
-	wl_list_for_each(c, &clients, link) {
-		if (!VISIBLEON(c, m) || c->isfloating || c->isfullscreen)
-			continue;
-		n++;
-		if (!monoclegaps)
-			resize(c, m->w, 0);
-		else
-			resize(c, (struct wlr_box){.x = m->w.x + gappoh, .y = m->w.y + gappov,
-				.width = m->w.width - 2 * gappoh, .height = m->w.height - 2 * gappov}, 0);
-	}
+	applylayout(m, monoclegeom, (LayoutParams){
+		.gappoh = monoclegaps ? (int)gappoh : 0,
+		.gappov = monoclegaps ? (int)gappov : 0});
 	if (n)
 		snprintf(m->ltsymbol, LENGTH(m->ltsymbol), "[%d]", n);
 	if ((c = focustop(m)))
@@ -2581,6 +3361,7 @@ movestack(const Arg *arg)
 
     wl_list_remove(&sel->link);
     wl_list_insert(&c->link, &sel->link);
+    reindex(sel);
     arrange(selmon);
 }
 
@@ -2613,7 +3394,7 @@ motionnotify(uint32_t time, struct wlr_input_device *device, double dx, double d
 	Client *c = NULL, *w = NULL;
 	LayerSurface *l = NULL;
 	struct wlr_surface *surface = NULL;
-	struct wlr_pointer_constraint_v1 *constraint;
+	struct wlr_relative_pointer_v1 *rp;
 
 	/* Find the client under the pointer and send the event along. */
 	xytonode(cursor->x, cursor->y, &surface, &c, NULL, &sx, &sy);
@@ -2632,10 +3413,15 @@ motionnotify(uint32_t time, struct wlr_input_device *device, double dx, double d
 		wlr_relative_pointer_manager_v1_send_relative_motion(
 				relative_pointer_mgr, seat, (uint64_t)time * 1000,
 				dx, dy, dx_unaccel, dy_unaccel);
+		/* relative motion isn't postponed, frame it if it was sent */
+		wl_list_for_each(rp, &relative_pointer_mgr->relative_pointers, link) {
+			if (rp->seat == seat && seat->pointer_state.focused_client
+					&& wl_resource_get_client(rp->resource)
+					== seat->pointer_state.focused_client->client)
+				framepending = 1;
+		}
 
-		wl_list_for_each(constraint, &pointer_constraints->constraints, link)
-			cursorconstrain(constraint);
-
+		/* active_constraint follows pointer focus, see pointerfocus() */
 		if (active_constraint && cursor_mode != CurResize && cursor_mode != CurMove) {
 			toplevel_from_wlr_surface(active_constraint->surface, &c, NULL);
 			if (c && active_constraint->surface == seat->pointer_state.focused_surface) {
@@ -2663,15 +3449,22 @@ motionnotify(uint32_t time, struct wlr_input_device *device, double dx, double d
 	/* Update drag icon's position */
 	wlr_scene_node_set_position(&drag_icon->node, (int)round(cursor->x), (int)round(cursor->y));
 
-	/* If we are currently grabbing the mouse, handle and return */
-	if (cursor_mode == CurMove) {
-		/* Move the grabbed client to the new position. */
-		resize(grabc, (struct wlr_box){.x = (int)round(cursor->x) - grabcx, .y = (int)round(cursor->y) - grabcy,
-			.width = grabc->geom.width, .height = grabc->geom.height}, 1);
-		return;
-	} else if (cursor_mode == CurResize) {
-		resize(grabc, (struct wlr_box){.x = grabc->geom.x, .y = grabc->geom.y,
-			.width = (int)round(cursor->x) - grabc->geom.x, .height = (int)round(cursor->y) - grabc->geom.y}, 1);
+	/* If we are currently grabbing the mouse, record the new geometry and
+	 * return, rendermon() applies it */
+	if (cursor_mode == CurMove || cursor_mode == CurResize) {
+		if (cursor_mode == CurMove)
+			grabgeom = (struct wlr_box){.x = (int)round(cursor->x) - grabcx, .y = (int)round(cursor->y) - grabcy,
+				.width = grabc->geom.width, .height = grabc->geom.height};
+		else
+			grabgeom = (struct wlr_box){.x = grabc->geom.x, .y = grabc->geom.y,
+				.width = (int)round(cursor->x) - grabc->geom.x, .height = (int)round(cursor->y) - grabc->geom.y};
+		grabpending = 1;
+		/* a disabled output doesn't render frames */
+		grabmon = xytomon(cursor->x, cursor->y);
+		if (grabmon && grabmon->wlr_output->enabled)
+			wlr_output_schedule_frame(grabmon->wlr_output);
+		else
+			applygrab(1);
 		return;
 	}
 
@@ -2814,6 +3607,10 @@ pointerfocus(Client *c, struct wlr_surface *surface, double sx, double sy,
 			sloppyfocus && time && c && !client_is_unmanaged(c))
 		focusclient(c, 0);
 
+	/* Only the constraint of the focused surface may be active */
+	if (surface != seat->pointer_state.focused_surface)
+		cursorconstrain(constraintat(surface));
+
 	/* If surface is NULL, clear pointer focus */
 	if (!surface) {
 		wlr_seat_pointer_notify_clear_focus(seat);
@@ -2825,19 +3622,47 @@ pointerfocus(Client *c, struct wlr_surface *surface, double sx, double sy,
 		time = now.tv_sec * 1000 + now.tv_nsec / 1000000;
 	}
 
+	/* Clients with lazymotion set get at most one motion event per frame of
+	 * their monitor, the pending one is sent before any button or axis
+	 * event. Relative motion and drags are still sent for every event. */
+	if (c && c->lazymotion && c->mon && !seat->drag
+			&& surface == seat->pointer_state.focused_surface) {
+		motionsurface = surface;
+		motionsx = sx;
+		motionsy = sy;
+		motiontime = time;
+		motionmon = c->mon;
+		wlr_output_schedule_frame(c->mon->wlr_output);
+		return;
+	}
+	motionsurface = NULL;
+
 	/* Let the client know that the mouse cursor has entered one
 	 * of its surfaces, and make keyboard focus follow if desired.
 	 * wlroots makes this a no-op if surface is already focused */
 	wlr_seat_pointer_notify_enter(seat, surface, sx, sy);
 	wlr_seat_pointer_notify_motion(seat, time, sx, sy);
+	framepending = 1;
 }
 
 void
 printstatus(void)
 {
-	Monitor *m = NULL;
-	wl_list_for_each(m, &mons, link)
-		dwl_ipc_output_printstatus(m);
+	/* Status is sent once per event loop iteration, see printstatusidle() */
+	if (!status_idle)
+		status_idle = wl_event_loop_add_idle(event_loop, printstatusidle, NULL);
+}
+
+void
+printstatusidle(void *data)
+{
+	Monitor *m;
+
+	status_idle = NULL;
+	wl_list_for_each(m, &mons, link) {
+		if (dwl_ipc_output_status_update(m))
+			dwl_ipc_output_printstatus(m);
+	}
 }
 
 void
@@ -2855,6 +3680,32 @@ powermgrsetmode(struct wl_listener *listener, void *data)
 	wlr_output_commit_state(m->wlr_output, &state);
 
 	m->asleep = !event->mode;
+	/* no frames will come to flush them */
+	if (m->asleep) {
+		flushtitles(m);
+		if (m == grabmon)
+			applygrab(1);
+	}
+}
+
+void
+propagatetitle(Client *c)
+{
+	const char *title;
+
+	wl_list_remove(&c->titlelink);
+	wl_list_init(&c->titlelink);
+	if (!(title = client_get_title(c)))
+		title = broken;
+	if (c->title && !strcmp(c->title, title))
+		return;
+
+	free(c->title);
+	c->title = strdup(title);
+	if (c->foreign_toplevel)
+		wlr_foreign_toplevel_handle_v1_set_title(c->foreign_toplevel, title);
+	if (c->mon && c == focustop(c->mon))
+		printstatus();
 }
 
 void
@@ -2872,22 +3723,95 @@ restorerlimit(void)
 		die("setrlimit:");
 }
 
+void
+reindex(Client *c)
+{
+	/* Move c to the list of its monitor matching its current state, must be
+	 * called after changing its monitor, tags, floating or fullscreen state
+	 * or its position in the clients list */
+	Client *p;
+
+	wl_list_remove(&c->vlink);
+	wl_list_init(&c->vlink);
+	if (!(c->vlist = visiblelist(c)))
+		return;
+
+	/* keep tiling order: insert after the closest preceding client in the
+	 * same list */
+	for (p = wl_container_of(c->link.prev, p, link); &p->link != &clients;
+			p = wl_container_of(p->link.prev, p, link)) {
+		if (p->vlist == c->vlist)
+			break;
+	}
+	wl_list_insert(&p->link != &clients ? &p->vlink : c->vlist, &c->vlink);
+}
+
+void
+reindexmon(Monitor *m)
+{
+	/* Rebuild all lists of m in a single pass, used when its tagset changes */
+	Client *c;
+
+	wl_list_init(&m->tiled);
+	wl_list_init(&m->floating);
+	wl_list_init(&m->fullscreen);
+	wl_list_for_each(c, &clients, link) {
+		if (c->mon != m)
+			continue;
+		wl_list_init(&c->vlink);
+		if ((c->vlist = visiblelist(c)))
+			wl_list_insert(c->vlist->prev, &c->vlink);
+	}
+}
+
+const unsigned long *
+rulematch(const char *appid, const char *title)
+{
+	/* Every client is matched on its initial commit and again on map, and
+	 * clients are often launched in batches, so cache the matched rules */
+	RuleMatch *e = &rulecache[(strhash(appid) * 31 + strhash(title)) % LENGTH(rulecache)];
+	const Rule *r;
+	size_t i;
+
+	if (e->appid && e->title && !strcmp(e->appid, appid) && !strcmp(e->title, title))
+		return e->match;
+
+	free(e->appid);
+	free(e->title);
+	e->appid = strdup(appid);
+	e->title = strdup(title);
+	memset(e->match, 0, sizeof(e->match));
+	for (i = 0; i < LENGTH(rules); i++) {
+		r = &rules[i];
+		if ((!r->title || strstr(title, r->title))
+				&& (!r->id || strstr(appid, r->id)))
+			e->match[i / ULBITS] |= 1UL << i % ULBITS;
+	}
+	return e->match;
+}
+
 void
 rendermon(struct wl_listener *listener, void *data)
 {
 	/* This function is called every time an output is ready to display a frame,
 	 * generally at the output's refresh rate (e.g. 60Hz). */
 	Monitor *m = wl_container_of(listener, m, frame);
-	Client *c;
 	struct wlr_output_state pending = {0};
 	struct wlr_gamma_control_v1 *gamma_control;
 	struct timespec now;
 
-	/* Render if no XDG clients have an outstanding resize and are visible on
-	 * this monitor. */
-	wl_list_for_each(c, &clients, link) {
-		if (c->resize && !c->isfloating && client_is_rendered_on_mon(c, m) && !client_is_stopped(c))
+	flushtitles(m);
+	if (m == grabmon)
+		applygrab(0);
+	if (m == motionmon)
+		flushmotion();
+
+	/* Hold back the frame until every client of the running resize
+	 * transaction has acked its configure, or the transaction timed out. */
+	if (m->txnpending) {
+		if (txnwaiting(m))
 			goto skip;
+		txnend(m, 0);
 	}
 
 	/*
@@ -2898,6 +3822,7 @@ rendermon(struct wl_listener *listener, void *data)
 	 * and commit the rest of the state in the next one (or in the same frame if
 	 * the gamma can not be committed).
 	 */
+	benchstart(BenchCommit);
 	if (m->gamma_lut_changed) {
 		gamma_control
 				= wlr_gamma_control_manager_v1_get_control(gamma_control_mgr, m->wlr_output);
@@ -2916,6 +3841,8 @@ rendermon(struct wl_listener *listener, void *data)
 commit:
 		wlr_scene_output_commit(m->scene_output, NULL);
 	}
+	benchstop(BenchCommit);
+	benchframe(m);
 
 skip:
 	/* Let clients know a frame has been rendered */
@@ -2927,7 +3854,7 @@ skip:
 void
 requestdecorationmode(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, set_decoration_mode);
+	Client *c = LISTENER_CLIENT(listener, set_decoration_mode);
 	if (c->surface.xdg->initialized)
 		wlr_xdg_toplevel_decoration_v1_set_mode(c->decoration,
 				WLR_XDG_TOPLEVEL_DECORATION_V1_MODE_SERVER_SIDE);
@@ -2964,25 +3891,34 @@ resize(Client *c, struct wlr_box geo, int interact)
 
 	bbox = interact ? &sgeom : &c->mon->w;
 
+	/* this is a no-op if the bounds haven't changed */
 	client_set_bounds(c, geo.width, geo.height);
 	c->geom = geo;
 	applybounds(c, bbox);
 
+	/* Layouts call this for every tiled client on each arrange, usually
+	 * nothing moved; only the clip may change with the client's geometry */
+	if (wlr_box_equal(&c->geom, &c->applied) && c->bw == c->appliedbw)
+		goto clip;
+	c->applied = c->geom;
+	c->appliedbw = c->bw;
+	scenegen++;
+
 	/* Update scene-graph, including borders */
 	wlr_scene_node_set_position(&c->scene->node, c->geom.x, c->geom.y);
 	wlr_scene_node_set_position(&c->scene_surface->node, c->bw, c->bw);
-	wlr_scene_rect_set_size(c->border[0], c->geom.width, c->bw);
-	wlr_scene_rect_set_size(c->border[1], c->geom.width, c->bw);
-	wlr_scene_rect_set_size(c->border[2], c->bw, c->geom.height - 2 * c->bw);
-	wlr_scene_rect_set_size(c->border[3], c->bw, c->geom.height - 2 * c->bw);
-	wlr_scene_node_set_position(&c->border[1]->node, 0, c->geom.height - c->bw);
-	wlr_scene_node_set_position(&c->border[2]->node, 0, c->bw);
-	wlr_scene_node_set_position(&c->border[3]->node, c->geom.width - c->bw, c->bw);
+	updateborder(c);
 
 	/* this is a no-op if size hasn't changed */
 	c->resize = client_set_size(c, c->geom.width - 2 * c->bw,
 			c->geom.height - 2 * c->bw);
+
+clip:
 	client_get_clip(c, &clip);
+	if (wlr_box_equal(&clip, &c->clip))
+		return;
+	c->clip = clip;
+	scenegen++;
 	wlr_scene_subsurface_tree_set_clip(&c->scene_surface->node, &clip);
 }
 
@@ -3001,22 +3937,17 @@ run(char *startup_cmd)
 		die("startup: backend_start");
 
 	/* Now that the socket exists and the backend is started, run the startup command */
+#ifndef BENCH
 	autostartexec();
+#endif
 	if (startup_cmd) {
 		int piperw[2];
+		char *argv[] = {"/bin/sh", "-c", startup_cmd, NULL};
 		if (pipe(piperw) < 0)
 			die("startup: pipe:");
-		if ((child_pid = fork()) < 0)
-			die("startup: fork:");
-		if (child_pid == 0) {
-			restorerlimit();
-			setsid();
-			dup2(piperw[0], STDIN_FILENO);
-			close(piperw[0]);
-			close(piperw[1]);
-			execl("/bin/sh", "/bin/sh", "-c", startup_cmd, NULL);
-			die("startup: execl:");
-		}
+		fcntl(piperw[1], F_SETFD, FD_CLOEXEC);
+		if ((child_pid = spawnv(argv, piperw[0], -1)) < 0)
+			die("startup: spawn");
 		dup2(piperw[1], STDOUT_FILENO);
 		close(piperw[1]);
 		close(piperw[0]);
@@ -3086,6 +4017,7 @@ setfloating(Client *c, int floating)
 {
 	Client *p = client_get_parent(c);
 	c->isfloating = floating;
+	reindex(c);
 	/* If in floating layout do not change the client's layer */
 	if (!c->mon || !client_surface(c)->mapped || !c->mon->lt[c->mon->sellt]->arrange)
 		return;
@@ -3100,6 +4032,7 @@ void
 setfullscreen(Client *c, int fullscreen)
 {
 	c->isfullscreen = fullscreen;
+	reindex(c);
 	if (!c->mon || !client_surface(c)->mapped)
 		return;
 	c->bw = fullscreen ? 0 : borderpx;
@@ -3261,8 +4194,14 @@ setmon(Client *c, Monitor *m, uint32_t newtags)
 
 	if (oldmon == m)
 		return;
+	/* flushtitles() only flushes titles of clients on its monitor */
+	if (!wl_list_empty(&c->titlelink))
+		propagatetitle(c);
 	c->mon = m;
 	c->prev = c->geom;
+	if (m)
+		c->tags = newtags ? newtags : m->tagset[m->seltags]; /* assign tags of target monitor */
+	reindex(c);
 
 	/* Scene graph sends surface leave/enter events on move and resize */
 	if (oldmon) {
@@ -3273,7 +4212,6 @@ setmon(Client *c, Monitor *m, uint32_t newtags)
 	if (m) {
 		/* Make sure window actually overlaps with the monitor */
 		resize(c, c->geom, 0);
-		c->tags = newtags ? newtags : m->tagset[m->seltags]; /* assign tags of target monitor */
 		if (c->foreign_toplevel)
 			wlr_foreign_toplevel_handle_v1_output_enter(c->foreign_toplevel, m->wlr_output);
 		setfullscreen(c, c->isfullscreen); /* This will call arrange(c->mon) */
@@ -3311,8 +4249,7 @@ setsel(struct wl_listener *listener, void *data)
 void
 setup(void)
 {
-	struct rlimit new_rlimit;
-	int i, sig[] = {SIGCHLD, SIGINT, SIGTERM, SIGPIPE};
+	int i, sig[] = {SIGINT, SIGTERM, SIGPIPE};
 	struct sigaction sa = {.sa_flags = SA_RESTART, .sa_handler = handlesig};
 	sigemptyset(&sa.sa_mask);
 
@@ -3325,6 +4262,10 @@ setup(void)
 
 	for (i = 0; i < (int)LENGTH(sig); i++)
 		sigaction(sig[i], &sa, NULL);
+	for (i = 0; i < (int)LENGTH(proctab); i++)
+		wl_list_init(&proctab[i]);
+
+	hashbindings();
 
 	wlr_log_init(log_level, NULL);
 
@@ -3332,6 +4273,8 @@ setup(void)
 	 * clients from the Unix socket, manging Wayland globals, and so on. */
 	dpy = wl_display_create();
 	event_loop = wl_display_get_event_loop(dpy);
+	sigchld_source = wl_event_loop_add_signal(event_loop, SIGCHLD, childstatus, NULL);
+	sigusr1_source = wl_event_loop_add_signal(event_loop, SIGUSR1, logstats, NULL);
 
 	/* The backend is a wlroots feature which abstracts the underlying input and
 	 * output hardware. The autocreate option will choose the most suitable
@@ -3427,6 +4370,7 @@ setup(void)
 	 */
 	wl_list_init(&clients);
 	wl_list_init(&fstack);
+	wl_list_init(&titles);
 
 	xdg_shell = wlr_xdg_shell_create(dpy, 6);
 	LISTEN_STATIC(&xdg_shell->events.new_toplevel, createnotify);
@@ -3438,6 +4382,7 @@ setup(void)
 	idle_notifier = wlr_idle_notifier_v1_create(dpy);
 
 	idle_inhibit_mgr = wlr_idle_inhibit_v1_create(dpy);
+	wl_list_init(&inhibitors);
 	LISTEN_STATIC(&idle_inhibit_mgr->events.new_inhibitor, createidleinhibitor);
 
 	session_lock_mgr = wlr_session_lock_manager_v1_create(dpy);
@@ -3455,6 +4400,8 @@ setup(void)
 	LISTEN_STATIC(&xdg_decoration_mgr->events.new_toplevel_decoration, createdecoration);
 
 	pointer_constraints = wlr_pointer_constraints_v1_create(dpy);
+	for (i = 0; i < (int)LENGTH(constrainttab); i++)
+		wl_list_init(&constrainttab[i]);
 	LISTEN_STATIC(&pointer_constraints->events.new_constraint, createpointerconstraint);
 
 	relative_pointer_mgr = wlr_relative_pointer_manager_v1_create(dpy);
@@ -3518,7 +4465,7 @@ setup(void)
 	LISTEN_STATIC(&output_mgr->events.apply, outputmgrapply);
 	LISTEN_STATIC(&output_mgr->events.test, outputmgrtest);
 
-	wl_global_create(dpy, &zdwl_ipc_manager_v2_interface, 2, NULL, dwl_ipc_manager_bind);
+	wl_global_create(dpy, &zdwl_ipc_manager_v2_interface, 3, NULL, dwl_ipc_manager_bind);
 
 	/* Make sure XWayland clients don't connect to the parent X server,
 	 * e.g when running in the x11 backend or the wayland backend and the
@@ -3540,26 +4487,83 @@ setup(void)
 #endif
 }
 
+void
+showinhibitors(InhibitorCount *ic, int shown)
+{
+	/* The owner of ic was shown or hidden, visibility of idle inhibitors
+	 * only changes with their window or layer surface */
+	if (ic->shown == shown)
+		return;
+	ic->shown = shown;
+	if (!ic->n)
+		return;
+	nvisibleinhibitors += shown ? ic->n : -ic->n;
+	wlr_idle_notifier_v1_set_inhibited(idle_notifier, nvisibleinhibitors > 0);
+}
+
 void
 spawn(const Arg *arg)
 {
-	if (fork() == 0) {
-		restorerlimit();
-		dup2(STDERR_FILENO, STDOUT_FILENO);
-		setsid();
-		execvp(((char **)arg->v)[0], (char **)arg->v);
-		die("dwl: execvp %s failed:", ((char **)arg->v)[0]);
-	}
+	spawnv((char **)arg->v, -1, STDERR_FILENO);
 }
 
 void spawnscratch(const Arg *arg)
 {
-	if (fork() == 0) {
-		dup2(STDERR_FILENO, STDOUT_FILENO);
-		setsid();
-		execvp(((char **)arg->v)[1], ((char **)arg->v)+1);
-		die("dwl: execvp %s failed:", ((char **)arg->v)[1]);
+	spawnv(((char **)arg->v) + 1, -1, STDERR_FILENO);
+}
+
+pid_t
+spawnv(char *const argv[], int fdin, int fdout)
+{
+	/* Unlike fork(), posix_spawn() doesn't copy the page tables of the whole
+	 * compositor, the child runs in our address space until it execs
+	 * (CLONE_VM|CLONE_VFORK on glibc and musl) */
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	sigset_t mask;
+	struct timespec start, end;
+	pid_t pid;
+	int err;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	posix_spawn_file_actions_init(&actions);
+	if (fdin >= 0) {
+		posix_spawn_file_actions_adddup2(&actions, fdin, STDIN_FILENO);
+		posix_spawn_file_actions_addclose(&actions, fdin);
+	}
+	if (fdout >= 0)
+		posix_spawn_file_actions_adddup2(&actions, fdout, STDOUT_FILENO);
+
+	/* The event loop blocks SIGCHLD to read it from a signalfd, don't let
+	 * spawned processes inherit that */
+	sigemptyset(&mask);
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setsigmask(&attr, &mask);
+	/* a session of its own like setsid(), needs glibc 2.26 or musl 1.1.24 */
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSID);
+
+	/* the child inherits our raised RLIMIT_NOFILE */
+	restorerlimit();
+	err = posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ);
+	if (og_rlimit.rlim_cur && setrlimit(RLIMIT_NOFILE, &new_rlimit) < 0)
+		die("setrlimit:");
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+	if (err) {
+		wlr_log(WLR_ERROR, "spawn %s: %s", argv[0], strerror(err));
+		return -1;
 	}
+
+	trackproc(pid, argv[0]);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	nspawned++;
+	spawnlatency = (end.tv_sec - start.tv_sec) * 1000000
+			+ (end.tv_nsec - start.tv_nsec) / 1000;
+	spawnlatencymax = MAX(spawnlatencymax, spawnlatency);
+	wlr_log(WLR_DEBUG, "spawned %s in %ld us (max %ld us over %lu)",
+			argv[0], spawnlatency, spawnlatencymax, nspawned);
+	return pid;
 }
 
 void
@@ -3573,6 +4577,56 @@ startdrag(struct wl_listener *listener, void *data)
 	LISTEN_STATIC(&drag->icon->events.destroy, destroydragicon);
 }
 
+int
+stophidden(void *data)
+{
+	/* c was hidden for hidden_stop_delay seconds, stop its process unless
+	 * another of its windows or surfaces is shown */
+	Client *w, *c = data;
+	LayerSurface *l;
+	Monitor *m;
+#ifdef XWAYLAND
+	struct wlr_scene_node *node;
+#endif
+	pid_t lpid, pid = client_get_pid(c);
+	size_t i;
+
+	if (c->scene->node.enabled || pid <= 1 || pid == getpid())
+		return 0;
+#ifdef XWAYLAND
+	if (xwayland && pid == xwayland->server->pid)
+		return 0;
+#endif
+	wl_list_for_each(w, &clients, link)
+		if (w != c && client_get_pid(w) == pid
+				&& (w->scene->node.enabled || w->sigstopped))
+			return 0;
+#ifdef XWAYLAND
+	/* unmanaged windows aren't in clients, they are floating */
+	wl_list_for_each(node, &layers[LyrFloat]->children, link) {
+		if ((w = node->data) && node->enabled && w->type == X11
+				&& client_is_unmanaged(w) && client_get_pid(w) == pid)
+			return 0;
+	}
+#endif
+	wl_list_for_each(m, &mons, link) {
+		for (i = 0; i < LENGTH(m->layers); i++) {
+			wl_list_for_each(l, &m->layers[i], link) {
+				wl_client_get_credentials(wl_resource_get_client(l->layer_surface->resource),
+						&lpid, NULL, NULL);
+				if (l->mapped && lpid == pid)
+					return 0;
+			}
+		}
+	}
+
+	if (kill(pid, SIGSTOP) < 0)
+		return 0;
+	c->sigstopped = 1;
+	nsigstopped++;
+	return 0;
+}
+
 void
 tag(const Arg *arg)
 {
@@ -3581,6 +4635,7 @@ tag(const Arg *arg)
 		return;
 
 	sel->tags = arg->ui & TAGMASK;
+	reindex(sel);
 	focusclient(focustop(selmon), 1);
 	arrange(selmon);
 	printstatus();
@@ -3597,44 +4652,10 @@ tagmon(const Arg *arg)
 void
 tile(Monitor *m)
 {
-	unsigned int mw, my, ty, h, r, oe = enablegaps, ie = enablegaps;
-	int i, n = 0;
-	Client *c;
-
-	wl_list_for_each(c, &clients, link)
-		if (VISIBLEON(c, m) && !c->isfloating && !c->isfullscreen)
-			n++;
-	if (n == 0)
-		return;
-
-	if (smartgaps == n) {
-		oe = 0; // outer gaps disabled
-	}
-
-	if (n > m->nmaster)
-		mw = m->nmaster ? (int)roundf((m->w.width + m->gappiv * ie) * m->mfact) : 0;
-	else
-		mw = m->w.width - 2*m->gappov*oe + m->gappiv*ie;
-	i = 0;
-	my = ty = m->gappoh*oe;
-	wl_list_for_each(c, &clients, link) {
-		if (!VISIBLEON(c, m) || c->isfloating || c->isfullscreen)
-			continue;
-		if (i < m->nmaster) {
-			r = MIN(n, m->nmaster) - i;
-			h = (m->w.height - my - m->gappoh*oe - m->gappih*ie * (r - 1)) / r;
-			resize(c, (struct wlr_box){.x = m->w.x + m->gappov*oe, .y = m->w.y + my,
-				.width = mw - m->gappiv*ie, .height = h}, 0);
-			my += c->geom.height + m->gappih*ie;
-		} else {
-			r = n - i;
-			h = (m->w.height - ty - m->gappoh*oe - m->gappih*ie * (r - 1)) / r;
-			resize(c, (struct wlr_box){.x = m->w.x + mw + m->gappov*oe, .y = m->w.y + ty,
-				.width = m->w.width - mw - 2*m->gappov*oe, .height = h}, 0);
-			ty += c->geom.height + m->gappih*ie;
-		}
-		i++;
-	}
+	applylayout(m, tilegeom, (LayoutParams){
+		.gappoh = m->gappoh * enablegaps, .gappov = m->gappov * enablegaps,
+		.gappih = m->gappih * enablegaps, .gappiv = m->gappiv * enablegaps,
+		.smartgaps = smartgaps, .mfact = m->mfact, .nmaster = m->nmaster});
 }
 
 void
@@ -3676,6 +4697,7 @@ togglescratch(const Arg *arg)
 
 	if (found) {
 		c->tags = VISIBLEON(c, selmon) ? 0 : selmon->tagset[selmon->seltags];
+		reindex(c);
 
 		focusclient(c->tags == 0 ? focustop(selmon) : c, 1);
 		arrange(selmon);
@@ -3746,6 +4768,7 @@ toggletag(const Arg *arg)
 		return;
 
 	sel->tags = newtags;
+	reindex(sel);
 	focusclient(focustop(selmon), 1);
 	arrange(selmon);
 	printstatus();
@@ -3779,16 +4802,110 @@ toggleview(const Arg *arg)
 	selmon->lt[selmon->sellt^1] = selmon->pertag->ltidxs[selmon->pertag->curtag][selmon->sellt^1];
 
 	selmon->tagset[selmon->seltags] = newtagset;
+	reindexmon(selmon);
 	focusclient(focustop(selmon), 1);
 	arrange(selmon);
 	printstatus();
 }
 
+void
+txnbegin(Monitor *m)
+{
+	/* All configures sent by arranging m form one transaction, committed by
+	 * rendermon() once every client acked or after resize_timeout ms, so a
+	 * slow client can't freeze the whole monitor. Arranging while a
+	 * transaction is running joins it without extending the deadline. */
+	if (m->txnpending || !txnwaiting(m))
+		return;
+	m->txnpending = 1;
+	m->txnpolled = 0;
+	clock_gettime(CLOCK_MONOTONIC, &m->txnstart);
+	wl_event_source_timer_update(m->txn_timer, resize_timeout / 2);
+}
+
+void
+txnend(Monitor *m, int timedout)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	m->txnpending = 0;
+	m->txnlatency = (now.tv_sec - m->txnstart.tv_sec) * 1000
+			+ (now.tv_nsec - m->txnstart.tv_nsec) / 1000000;
+	if (!timedout)
+		wl_event_source_timer_update(m->txn_timer, 0);
+	wlr_log(timedout ? WLR_INFO : WLR_DEBUG, "%s: resize transaction %s after %d ms",
+			m->wlr_output->name, timedout ? "timed out" : "done", m->txnlatency);
+}
+
+int
+txntimeout(void *data)
+{
+	Monitor *m = data;
+	Client *c;
+
+	/* Halfway through, look again for clients that aren't our children
+	 * and stopped after client_is_stopped() polled them */
+	if (!m->txnpolled) {
+		m->txnpolled = 1;
+		wl_list_for_each(c, &clients, link) {
+			if (c->mon == m && c->resize && !c->ischild)
+				c->stoppedserial = 0;
+		}
+		wl_event_source_timer_update(m->txn_timer, resize_timeout - resize_timeout / 2);
+		wlr_output_schedule_frame(m->wlr_output);
+		return 0;
+	}
+	wl_list_for_each(c, &clients, link) {
+		if (c->mon == m && c->resize)
+			c->txnlate = 1;
+	}
+	txnend(m, 1);
+	wlr_output_schedule_frame(m->wlr_output);
+	return 0;
+}
+
+int
+txnwaiting(Monitor *m)
+{
+	/* Whether a visible tiled or fullscreen client still has to ack.
+	 * Clients that made a transaction time out aren't waited for again
+	 * until they ack. */
+	Client *c;
+
+	wl_list_for_each(c, &m->tiled, vlink) {
+		if (c->resize && !c->txnlate && client_is_rendered_on_mon(c, m) && !client_is_stopped(c))
+			return 1;
+	}
+	wl_list_for_each(c, &m->fullscreen, vlink) {
+		if (c->resize && !c->txnlate && !c->isfloating
+				&& client_is_rendered_on_mon(c, m) && !client_is_stopped(c))
+			return 1;
+	}
+	return 0;
+}
+
+Proc *
+trackproc(pid_t pid, const char *name)
+{
+	/* name must outlive the process, argv[0] of spawned commands always
+	 * lives in config.h or in a string literal */
+	Proc *p = ecalloc(1, sizeof(*p));
+
+	p->pid = pid;
+	p->name = name;
+	p->autostart = -1;
+	clock_gettime(CLOCK_MONOTONIC, &p->start);
+	wl_list_insert(&proctab[pid % LENGTH(proctab)], &p->link);
+	return p;
+}
+
 void
 unlocksession(struct wl_listener *listener, void *data)
 {
 	SessionLock *lock = wl_container_of(listener, lock, unlock);
 	destroylock(lock, 1);
+	scenegen++;
 }
 
 void
@@ -3798,6 +4915,7 @@ unmaplayersurfacenotify(struct wl_listener *listener, void *data)
 
 	l->mapped = 0;
 	wlr_scene_node_set_enabled(&l->scene->node, 0);
+	showinhibitors(&l->inhibitors, 0);
 	if (l == exclusive_focus)
 		exclusive_focus = NULL;
 	if (l->layer_surface->output && (l->mon = l->layer_surface->output->data))
@@ -3811,11 +4929,20 @@ void
 unmapnotify(struct wl_listener *listener, void *data)
 {
 	/* Called when the surface is unmapped, and should no longer be shown. */
-	Client *c = wl_container_of(listener, c, unmap);
+	Client *c = LISTENER_CLIENT(listener, unmap);
 	if (c == grabc) {
 		cursor_mode = CurNormal;
 		grabc = NULL;
+		grabpending = 0;
+	}
+	if (!wl_list_empty(&c->titlelink))
+		propagatetitle(c);
+	if (c->stop_timer) {
+		wl_event_source_remove(c->stop_timer);
+		c->stop_timer = NULL;
 	}
+	if (c->sigstopped)
+		contprocess(c->pid); /* while c is still in clients */
 
 	if (client_is_unmanaged(c)) {
 		if (c == exclusive_focus) {
@@ -3834,6 +4961,8 @@ unmapnotify(struct wl_listener *listener, void *data)
 	}
 
 	wlr_scene_node_destroy(&c->scene->node);
+	c->border[0] = NULL;
+	showinhibitors(&c->inhibitors, 0);
 	printstatus();
 	motionnotify(0, NULL, 0, 0, 0, 0);
 	if (c->switchtotag) {
@@ -3842,6 +4971,31 @@ unmapnotify(struct wl_listener *listener, void *data)
 	}
 }
 
+void
+updateborder(Client *c)
+{
+	/* The border rects are only created once the client is shown, so
+	 * clients on tags never viewed don't have them. They only cover the
+	 * border, translucent and uncovered parts of the client stay so. */
+	int i;
+
+	if (!c->border[0]) {
+		if (!c->bw || client_is_unmanaged(c) || !VISIBLEON(c, c->mon))
+			return;
+		for (i = 0; i < 4; i++) {
+			c->border[i] = wlr_scene_rect_create(c->scene, 0, 0, c->bordercolor);
+			c->border[i]->node.data = c;
+		}
+	}
+	wlr_scene_rect_set_size(c->border[0], c->geom.width, c->bw);
+	wlr_scene_rect_set_size(c->border[1], c->geom.width, c->bw);
+	wlr_scene_rect_set_size(c->border[2], c->bw, c->geom.height - 2 * c->bw);
+	wlr_scene_rect_set_size(c->border[3], c->bw, c->geom.height - 2 * c->bw);
+	wlr_scene_node_set_position(&c->border[1]->node, 0, c->geom.height - c->bw);
+	wlr_scene_node_set_position(&c->border[2]->node, 0, c->bw);
+	wlr_scene_node_set_position(&c->border[3]->node, c->geom.width - c->bw, c->bw);
+}
+
 void
 updatemons(struct wl_listener *listener, void *data)
 {
@@ -3858,6 +5012,7 @@ updatemons(struct wl_listener *listener, void *data)
 	struct wlr_output_configuration_head_v1 *config_head;
 	Monitor *m;
 
+	scenegen++;
 	/* First remove from the layout the disabled monitors */
 	wl_list_for_each(m, &mons, link) {
 		if (m->wlr_output->enabled || m->asleep)
@@ -3866,6 +5021,8 @@ updatemons(struct wl_listener *listener, void *data)
 		config_head->state.enabled = 0;
 		/* Remove this output from the layout to avoid cursor enter inside it */
 		wlr_output_layout_remove(output_layout, m->wlr_output);
+		if (m == grabmon)
+			applygrab(1);
 		closemon(m);
 		m->m = m->w = (struct wlr_box){0};
 	}
@@ -3951,15 +5108,25 @@ updatemons(struct wl_listener *listener, void *data)
 void
 updatetitle(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, set_title);
-	if (c->foreign_toplevel) {
-		const char *title;
-		if (!(title = client_get_title(c)))
-			title = broken;
-		wlr_foreign_toplevel_handle_v1_set_title(c->foreign_toplevel, title);
+	/* Programs like shells may set the title many times per second, so
+	 * changes are coalesced and propagated once per frame of the client's
+	 * monitor by rendermon(), with the latest title winning. */
+	Client *c = LISTENER_CLIENT(listener, set_title);
+	const char *title;
+
+	if (!wl_list_empty(&c->titlelink))
+		return;
+	if (!(title = client_get_title(c)))
+		title = broken;
+	if (c->title && !strcmp(c->title, title))
+		return;
+
+	if (!c->mon || !c->mon->wlr_output->enabled) {
+		propagatetitle(c);
+		return;
 	}
-	if (c == focustop(c->mon))
-		printstatus();
+	wl_list_insert(&titles, &c->titlelink);
+	wlr_output_schedule_frame(c->mon->wlr_output);
 }
 
 void
@@ -4008,11 +5175,36 @@ view(const Arg *arg)
 	selmon->lt[selmon->sellt] = selmon->pertag->ltidxs[selmon->pertag->curtag][selmon->sellt];
 	selmon->lt[selmon->sellt^1] = selmon->pertag->ltidxs[selmon->pertag->curtag][selmon->sellt^1];
 
+	reindexmon(selmon);
 	focusclient(focustop(selmon), 1);
 	arrange(selmon);
 	printstatus();
 }
 
+struct wl_list *
+visiblelist(Client *c)
+{
+	/* Return the list of its monitor c belongs to or NULL if it is hidden,
+	 * enabling or suspending it when its visibility changes */
+	int visible;
+
+	if (!c->mon || !client_surface(c)->mapped)
+		return NULL;
+
+	visible = VISIBLEON(c, c->mon);
+	if (c->scene->node.enabled != visible) {
+		hideclient(c, !visible);
+		wlr_scene_node_set_enabled(&c->scene->node, visible);
+		showinhibitors(&c->inhibitors, visible);
+	}
+	if (visible && !c->border[0])
+		updateborder(c);
+	if (!visible)
+		return NULL;
+	return c->isfullscreen ? &c->mon->fullscreen
+			: c->isfloating ? &c->mon->floating : &c->mon->tiled;
+}
+
 void
 virtualkeyboard(struct wl_listener *listener, void *data)
 {
@@ -4049,15 +5241,29 @@ void
 xytonode(double x, double y, struct wlr_surface **psurface,
 		Client **pc, LayerSurface **pl, double *nx, double *ny)
 {
-	struct wlr_scene_node *node, *pnode;
+	struct wlr_scene_node *node, *pnode, *hit = NULL;
 	struct wlr_surface *surface = NULL;
 	Client *c = NULL;
 	LayerSurface *l = NULL;
-	int layer;
+	double sx = 0, sy = 0;
+	int layer, px = (int)floor(x), py = (int)floor(y);
+
+	/* With high rate mice many motion events stay on the same pixel, where
+	 * wlr_scene_node_at() gives the same result until the scene changes.
+	 * Misses are cached as well. */
+	if (hitcache.gen == scenegen && hitcache.px == px && hitcache.py == py) {
+		if (psurface) *psurface = hitcache.surface;
+		if (pc) *pc = hitcache.c;
+		if (pl) *pl = hitcache.l;
+		if (nx && hitcache.node) *nx = x - hitcache.dx;
+		if (ny && hitcache.node) *ny = y - hitcache.dy;
+		return;
+	}
 
 	for (layer = NUM_LAYERS - 1; !surface && layer >= 0; layer--) {
-		if (!(node = wlr_scene_node_at(&layers[layer]->node, x, y, nx, ny)))
+		if (!(node = wlr_scene_node_at(&layers[layer]->node, x, y, &sx, &sy)))
 			continue;
+		hit = node;
 
 		if (node->type == WLR_SCENE_NODE_BUFFER)
 			surface = wlr_scene_surface_try_from_buffer(
@@ -4074,6 +5280,23 @@ xytonode(double x, double y, struct wlr_surface **psurface,
 	if (psurface) *psurface = surface;
 	if (pc) *pc = c;
 	if (pl) *pl = l;
+	if (nx && hit) *nx = sx;
+	if (ny && hit) *ny = sy;
+
+	/* The last node hit goes away with everything the result points to */
+	if (hitcache.node)
+		destroyhitnode(&hitcache.destroy, NULL);
+	hitcache.px = px;
+	hitcache.py = py;
+	hitcache.gen = scenegen;
+	hitcache.node = hit;
+	hitcache.surface = surface;
+	hitcache.c = c;
+	hitcache.l = l;
+	hitcache.dx = x - sx;
+	hitcache.dy = y - sy;
+	if (hit)
+		LISTEN(&hit->events.destroy, &hitcache.destroy, destroyhitnode);
 }
 
 void
@@ -4104,6 +5327,7 @@ zoom(const Arg *arg)
 		sel = c;
 	wl_list_remove(&sel->link);
 	wl_list_insert(&clients, &sel->link);
+	reindex(sel);
 
 	focusclient(sel, 1);
 	arrange(selmon);
@@ -4114,18 +5338,19 @@ createforeigntoplevel(Client *c)
 {
 	c->foreign_toplevel = wlr_foreign_toplevel_handle_v1_create(foreign_toplevel_mgr);
 
-	LISTEN(&c->foreign_toplevel->events.request_activate, &c->factivate, factivatenotify);
-	LISTEN(&c->foreign_toplevel->events.request_close, &c->fclose, fclosenotify);
-	LISTEN(&c->foreign_toplevel->events.request_fullscreen, &c->ffullscreen, ffullscreennotify);
-	LISTEN(&c->foreign_toplevel->events.destroy, &c->fdestroy, fdestroynotify);
+	LISTEN(&c->foreign_toplevel->events.request_activate, &c->ls->factivate, factivatenotify);
+	LISTEN(&c->foreign_toplevel->events.request_close, &c->ls->fclose, fclosenotify);
+	LISTEN(&c->foreign_toplevel->events.request_fullscreen, &c->ls->ffullscreen, ffullscreennotify);
+	LISTEN(&c->foreign_toplevel->events.destroy, &c->ls->fdestroy, fdestroynotify);
 }
 
 void
 factivatenotify(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, factivate);
+	Client *c = LISTENER_CLIENT(listener, factivate);
 	if (c->mon == selmon) {
 		c->tags = c->mon->tagset[c->mon->seltags];
+		reindex(c);
 	} else {
 		setmon(c, selmon, 0);
 	}
@@ -4136,13 +5361,13 @@ factivatenotify(struct wl_listener *listener, void *data)
 void
 fclosenotify(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, fclose);
+	Client *c = LISTENER_CLIENT(listener, fclose);
 	client_send_close(c);
 }
 
 void
 ffullscreennotify(struct wl_listener *listener, void *data) {
-	Client *c = wl_container_of(listener, c, ffullscreen);
+	Client *c = LISTENER_CLIENT(listener, ffullscreen);
 	struct wlr_foreign_toplevel_handle_v1_fullscreen_event *event = data;
 	setfullscreen(c, event->fullscreen);
 }
@@ -4150,11 +5375,11 @@ ffullscreennotify(struct wl_listener *listener, void *data) {
 void
 fdestroynotify(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, fdestroy);
-	wl_list_remove(&c->factivate.link);
-	wl_list_remove(&c->fclose.link);
-	wl_list_remove(&c->ffullscreen.link);
-	wl_list_remove(&c->fdestroy.link);
+	Client *c = LISTENER_CLIENT(listener, fdestroy);
+	wl_list_remove(&c->ls->factivate.link);
+	wl_list_remove(&c->ls->fclose.link);
+	wl_list_remove(&c->ls->ffullscreen.link);
+	wl_list_remove(&c->ls->fdestroy.link);
 }
 
 void
@@ -4166,13 +5391,11 @@ regions(const Arg *arg)
 
 	if (pipe(pipefd) == -1)
 		return;
-	if (fork() == 0) {
-		close(pipefd[1]);
-		dup2(pipefd[0], STDIN_FILENO);
+	fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
+	if (spawnv((char **)arg->v, pipefd[0], -1) < 0) {
 		close(pipefd[0]);
-		setsid();
-		execvp(((char **)arg->v)[0], (char **)arg->v);
-		die("dwl: execvp %s failed:", ((char **)arg->v)[0]);
+		close(pipefd[1]);
+		return;
 	}
 
 	close(pipefd[0]);
@@ -4188,7 +5411,7 @@ regions(const Arg *arg)
 void
 activatex11(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, activate);
+	Client *c = LISTENER_CLIENT(listener, activate);
 
 	/* Only "managed" windows can be activated */
 	if (!client_is_unmanaged(c))
@@ -4198,16 +5421,16 @@ activatex11(struct wl_listener *listener, void *data)
 void
 associatex11(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, associate);
+	Client *c = LISTENER_CLIENT(listener, associate);
 
-	LISTEN(&client_surface(c)->events.map, &c->map, mapnotify);
-	LISTEN(&client_surface(c)->events.unmap, &c->unmap, unmapnotify);
+	LISTEN(&client_surface(c)->events.map, &c->ls->map, mapnotify);
+	LISTEN(&client_surface(c)->events.unmap, &c->ls->unmap, unmapnotify);
 }
 
 void
 configurex11(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, configure);
+	Client *c = LISTENER_CLIENT(listener, configure);
 	struct wlr_xwayland_surface_configure_event *event = data;
 	/* TODO: figure out if there is another way to do this */
 	if (!c->mon) {
@@ -4220,6 +5443,8 @@ configurex11(struct wl_listener *listener, void *data)
 				.width = event->width + c->bw * 2, .height = event->height + c->bw * 2}, 0);
 	else
 		arrange(c->mon);
+	/* resize() skips unchanged geometry, but the client waits for a reply */
+	client_set_size(c, c->geom.width - 2 * c->bw, c->geom.height - 2 * c->bw);
 }
 
 void
@@ -4229,28 +5454,32 @@ createnotifyx11(struct wl_listener *listener, void *data)
 	Client *c;
 
 	/* Allocate a Client for this surface */
-	c = xsurface->data = ecalloc(1, sizeof(*c));
+	c = xsurface->data = poolalloc(&clientpool);
+	c->ls = poolalloc(&listenerpool);
+	c->ls->c = c;
 	c->surface.xwayland = xsurface;
 	c->type = X11;
 	c->bw = client_is_unmanaged(c) ? 0 : borderpx;
+	wl_list_init(&c->vlink);
+	wl_list_init(&c->titlelink);
 
 	/* Listen to the various events it can emit */
-	LISTEN(&xsurface->events.associate, &c->associate, associatex11);
-	LISTEN(&xsurface->events.destroy, &c->destroy, destroynotify);
-	LISTEN(&xsurface->events.dissociate, &c->dissociate, dissociatex11);
-	LISTEN(&xsurface->events.request_activate, &c->activate, activatex11);
-	LISTEN(&xsurface->events.request_configure, &c->configure, configurex11);
-	LISTEN(&xsurface->events.request_fullscreen, &c->fullscreen, fullscreennotify);
-	LISTEN(&xsurface->events.set_hints, &c->set_hints, sethints);
-	LISTEN(&xsurface->events.set_title, &c->set_title, updatetitle);
+	LISTEN(&xsurface->events.associate, &c->ls->associate, associatex11);
+	LISTEN(&xsurface->events.destroy, &c->ls->destroy, destroynotify);
+	LISTEN(&xsurface->events.dissociate, &c->ls->dissociate, dissociatex11);
+	LISTEN(&xsurface->events.request_activate, &c->ls->activate, activatex11);
+	LISTEN(&xsurface->events.request_configure, &c->ls->configure, configurex11);
+	LISTEN(&xsurface->events.request_fullscreen, &c->ls->fullscreen, fullscreennotify);
+	LISTEN(&xsurface->events.set_hints, &c->ls->set_hints, sethints);
+	LISTEN(&xsurface->events.set_title, &c->ls->set_title, updatetitle);
 }
 
 void
 dissociatex11(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, dissociate);
-	wl_list_remove(&c->map.link);
-	wl_list_remove(&c->unmap.link);
+	Client *c = LISTENER_CLIENT(listener, dissociate);
+	wl_list_remove(&c->ls->map.link);
+	wl_list_remove(&c->ls->unmap.link);
 }
 
 xcb_atom_t
@@ -4269,7 +5498,7 @@ getatom(xcb_connection_t *xc, const char *name)
 void
 sethints(struct wl_listener *listener, void *data)
 {
-	Client *c = wl_container_of(listener, c, set_hints);
+	Client *c = LISTENER_CLIENT(listener, set_hints);
 	struct wlr_surface *surface = client_surface(c);
 	if (c == focustop(selmon))
 		return;
@@ -4345,82 +5574,13 @@ usage:
 }
 
 static void
-bstack(Monitor *m) 
+bstack(Monitor *m)
 {
-	int w, h, mh, mx, tx, ty, tw;
-	int i, n = 0;
-	Client *c;
-
-	wl_list_for_each(c, &clients, link)
-		if (VISIBLEON(c, m) && !c->isfloating)
-			n++;
-	if (n == 0)
-		return;
-
-	if (n > m->nmaster) {
-		mh = (int)round(m->nmaster ? m->mfact * m->w.height : 0);
-		tw = m->w.width / (n - m->nmaster);
-		ty = m->w.y + mh;
-	} else {
-		mh = m->w.height;
-		tw = m->w.width;
-		ty = m->w.y;
-	}
-
-	i = mx = 0;
-	tx = m-> w.x;
-	wl_list_for_each(c, &clients, link) {
-		if (!VISIBLEON(c, m) || c->isfloating)
-			continue;
-		if (i < m->nmaster) {
-			w = (m->w.width - mx) / (MIN(n, m->nmaster) - i);
-			resize(c, (struct wlr_box) { .x = m->w.x + mx, .y = m->w.y, .width = w, .height = mh }, 0);
-			mx += c->geom.width;
-		} else {
-			h = m->w.height - mh;
-			resize(c, (struct wlr_box) { .x = tx, .y = ty, .width = tw, .height = h }, 0);
-			if (tw != m->w.width)
-				tx += c->geom.width;
-		}
-		i++;
-	}
+	applylayout(m, bstackgeom, (LayoutParams){.mfact = m->mfact, .nmaster = m->nmaster});
 }
 
 static void
-bstackhoriz(Monitor *m) {
-	int w, mh, mx, tx, ty, th;
-	int i, n = 0;
-	Client *c;
-
-	wl_list_for_each(c, &clients, link)
-		if (VISIBLEON(c, m) && !c->isfloating)
-			n ++;
-	if (n == 0)
-		return;
-
-	if (n > m->nmaster) {
-		mh = (int)round(m->nmaster ? m->mfact * m->w.height : 0);
-		th = (m->w.height - mh) / (n - m->nmaster);
-		ty = m->w.y + mh;
-	} else {
-		th = mh = m->w.height;
-		ty = m->w.y;
-	}
-
-	i = mx = 0;
-	tx = m-> w.x;
-	wl_list_for_each(c, &clients, link) {
-		if (!VISIBLEON(c,m) || c->isfloating)
-			continue;
-		if (i < m->nmaster) {
-			w = (m->w.width - mx) / (MIN(n, m->nmaster) - i);
-			resize(c, (struct wlr_box) { .x = m->w.x + mx, .y = m->w.y, .width = w, .height = mh }, 0);
-			mx += c->geom.width;
-		} else {
-			resize(c, (struct wlr_box) { .x = tx, .y = ty, .width = m->w.width, .height = th }, 0);
-			if (th != m->w.height)
-				ty += c->geom.height;
-		}
-		i++;
-	}
+bstackhoriz(Monitor *m)
+{
+	applylayout(m, bstackhorizgeom, (LayoutParams){.mfact = m->mfact, .nmaster = m->nmaster});
 }
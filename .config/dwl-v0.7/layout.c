@@ -0,0 +1,159 @@
+/* See LICENSE file for copyright and license details. */
+#include <math.h>
+#include <wlr/util/box.h>
+
+#include "layout.h"
+
+#define MIN(A, B)               ((A) < (B) ? (A) : (B))
+
+/* Sizes are handed out by dividing what is left of a row or column by the
+ * number of windows left in it, so the remainder pixels are spread over the
+ * windows and the area is covered exactly. */
+
+void
+bstackgeom(const LayoutParams *p, int n, struct wlr_box *boxes)
+{
+	const struct wlr_box *a = &p->area;
+	int i, mh, mx = 0, tx = 0;
+
+	if (n > p->nmaster)
+		mh = p->nmaster ? (int)round(p->mfact * a->height) : 0;
+	else
+		mh = a->height;
+
+	for (i = 0; i < n; i++) {
+		if (i < p->nmaster) {
+			boxes[i] = (struct wlr_box){ .x = a->x + mx, .y = a->y,
+				.width = (a->width - mx) / (MIN(n, p->nmaster) - i), .height = mh };
+			mx += boxes[i].width;
+		} else {
+			boxes[i] = (struct wlr_box){ .x = a->x + tx, .y = a->y + mh,
+				.width = (a->width - tx) / (n - i), .height = a->height - mh };
+			tx += boxes[i].width;
+		}
+	}
+}
+
+void
+bstackhorizgeom(const LayoutParams *p, int n, struct wlr_box *boxes)
+{
+	const struct wlr_box *a = &p->area;
+	int i, mh, mx = 0, ty;
+
+	if (n > p->nmaster)
+		mh = p->nmaster ? (int)round(p->mfact * a->height) : 0;
+	else
+		mh = a->height;
+
+	ty = mh;
+	for (i = 0; i < n; i++) {
+		if (i < p->nmaster) {
+			boxes[i] = (struct wlr_box){ .x = a->x + mx, .y = a->y,
+				.width = (a->width - mx) / (MIN(n, p->nmaster) - i), .height = mh };
+			mx += boxes[i].width;
+		} else {
+			boxes[i] = (struct wlr_box){ .x = a->x, .y = a->y + ty,
+				.width = a->width, .height = (a->height - ty) / (n - i) };
+			ty += boxes[i].height;
+		}
+	}
+}
+
+void
+deckgeom(const LayoutParams *p, int n, struct wlr_box *boxes)
+{
+	const struct wlr_box *a = &p->area;
+	int i, mw, my = 0;
+
+	if (n > p->nmaster)
+		mw = p->nmaster ? (int)round(a->width * p->mfact) : 0;
+	else
+		mw = a->width;
+
+	for (i = 0; i < n; i++) {
+		if (i < p->nmaster) {
+			boxes[i] = (struct wlr_box){ .x = a->x, .y = a->y + my, .width = mw,
+				.height = (a->height - my) / (MIN(n, p->nmaster) - i) };
+			my += boxes[i].height;
+		} else {
+			/* the stack is a deck of windows on top of each other */
+			boxes[i] = (struct wlr_box){ .x = a->x + mw, .y = a->y,
+				.width = a->width - mw, .height = a->height };
+		}
+	}
+}
+
+void
+gaplessgridgeom(const LayoutParams *p, int n, struct wlr_box *boxes)
+{
+	const struct wlr_box *a = &p->area;
+	int i, cols, rows, cn = 0, rn = 0, cx = 0, cy = 0;
+
+	/* grid dimensions */
+	for (cols = 0; cols <= n / 2; cols++)
+		if (cols * cols >= n)
+			break;
+
+	if (n == 5) /* set layout against the general calculation: not 1:2:2, but 2:3 */
+		cols = 2;
+
+	/* widescreen is better if 3 columns */
+	if (n >= 3 && n <= 6 && a->height && a->width / a->height > 1)
+		cols = 3;
+
+	rows = n / cols;
+	for (i = 0; i < n; i++) {
+		/* the last n % cols columns get one more row */
+		if (i / rows + 1 > cols - n % cols)
+			rows = n / cols + 1;
+		boxes[i] = (struct wlr_box){ .x = a->x + cx, .y = a->y + cy,
+			.width = (a->width - cx) / (cols - cn),
+			.height = (a->height - cy) / (rows - rn) };
+		cy += boxes[i].height;
+		if (++rn >= rows) {
+			rn = cy = 0;
+			cn++;
+			cx += boxes[i].width;
+		}
+	}
+}
+
+void
+monoclegeom(const LayoutParams *p, int n, struct wlr_box *boxes)
+{
+	const struct wlr_box *a = &p->area;
+	int i;
+
+	for (i = 0; i < n; i++)
+		boxes[i] = (struct wlr_box){ .x = a->x + p->gappoh, .y = a->y + p->gappov,
+			.width = a->width - 2 * p->gappoh, .height = a->height - 2 * p->gappov };
+}
+
+void
+tilegeom(const LayoutParams *p, int n, struct wlr_box *boxes)
+{
+	const struct wlr_box *a = &p->area;
+	int i, mw, my, ty, r, oe = p->smartgaps != n; /* outer gaps enabled */
+	int oh = p->gappoh * oe, ov = p->gappov * oe, ih = p->gappih, iv = p->gappiv;
+
+	if (n > p->nmaster)
+		mw = p->nmaster ? (int)roundf((float)(a->width + iv) * p->mfact) : 0;
+	else
+		mw = a->width - 2 * ov + iv;
+
+	my = ty = oh;
+	for (i = 0; i < n; i++) {
+		if (i < p->nmaster) {
+			r = MIN(n, p->nmaster) - i;
+			boxes[i] = (struct wlr_box){ .x = a->x + ov, .y = a->y + my, .width = mw - iv,
+				.height = (a->height - my - oh - ih * (r - 1)) / r };
+			my += boxes[i].height + ih;
+		} else {
+			r = n - i;
+			boxes[i] = (struct wlr_box){ .x = a->x + mw + ov, .y = a->y + ty,
+				.width = a->width - mw - 2 * ov,
+				.height = (a->height - ty - oh - ih * (r - 1)) / r };
+			ty += boxes[i].height + ih;
+		}
+	}
+}
@@ -0,0 +1,21 @@
+/* See LICENSE file for copyright and license details. */
+
+/* Input of the tiling layouts. They only compute geometry, dwl.c applies it,
+ * so they can be benchmarked and tested alone, see bench/layout.c */
+typedef struct {
+	struct wlr_box area; /* usable area of the monitor */
+	int gappoh, gappov, gappih, gappiv; /* zero when gaps are disabled */
+	int smartgaps; /* number of windows without outer gaps */
+	float mfact;
+	int nmaster;
+} LayoutParams;
+
+/* fill boxes[0..n-1] in the order of Monitor.tiled, n > 0 */
+typedef void (*LayoutFunc)(const LayoutParams *p, int n, struct wlr_box *boxes);
+
+void bstackgeom(const LayoutParams *p, int n, struct wlr_box *boxes);
+void bstackhorizgeom(const LayoutParams *p, int n, struct wlr_box *boxes);
+void deckgeom(const LayoutParams *p, int n, struct wlr_box *boxes);
+void gaplessgridgeom(const LayoutParams *p, int n, struct wlr_box *boxes);
+void monoclegeom(const LayoutParams *p, int n, struct wlr_box *boxes);
+void tilegeom(const LayoutParams *p, int n, struct wlr_box *boxes);
@@ -7,6 +7,11 @@
 
 #include "util.h"
 
+#define POOLALIGN 64 /* cache line */
+#define SLABOBJS  32 /* objects per slab */
+#define OBJSIZE(P) (((P)->size + POOLALIGN - 1) & ~(size_t)(POOLALIGN - 1))
+#define SLABNEXT(P, S) (*(void **)((char *)(S) + SLABOBJS * OBJSIZE(P)))
+
 void
 die(const char *fmt, ...) {
 	va_list ap;
@@ -49,3 +54,75 @@ fd_set_nonblock(int fd) {
 
 	return 0;
 }
+
+void *
+poolalloc(Pool *p)
+{
+	/* Like ecalloc(1, p->size) */
+	size_t size = OBJSIZE(p);
+	char *obj, *slab;
+	void *mem;
+	int i;
+
+	if (!p->freelist) {
+		if (posix_memalign(&mem, POOLALIGN, SLABOBJS * size + sizeof(void *)))
+			die("posix_memalign:");
+		slab = mem;
+		SLABNEXT(p, slab) = p->slabs;
+		p->slabs = slab;
+		p->nslabs++;
+		/* hand out objects in address order */
+		for (i = SLABOBJS - 1; i >= 0; i--) {
+			obj = slab + i * size;
+			*(void **)obj = p->freelist;
+			p->freelist = obj;
+		}
+	}
+
+	obj = p->freelist;
+	p->freelist = *(void **)obj;
+	memset(obj, 0, size);
+	if (++p->live > p->peak)
+		p->peak = p->live;
+	return obj;
+}
+
+size_t
+poolbytes(const Pool *p)
+{
+	return p->nslabs * (SLABOBJS * OBJSIZE(p) + sizeof(void *));
+}
+
+void
+pooldestroy(Pool *p)
+{
+	void *slab, *next;
+
+	for (slab = p->slabs; slab; slab = next) {
+		next = SLABNEXT(p, slab);
+		free(slab);
+	}
+	p->freelist = p->slabs = NULL;
+	p->live = p->nslabs = 0;
+}
+
+void
+poolfree(Pool *p, void *ptr)
+{
+	if (!ptr)
+		return;
+	*(void **)ptr = p->freelist;
+	p->freelist = ptr;
+	p->live--;
+}
+
+unsigned int
+strhash(const char *s)
+{
+	/* FNV-1a */
+	unsigned int h = 2166136261u;
+
+	while (*s)
+		h = (h ^ (unsigned char)*s++) * 16777619u;
+	return h;
+}
@@ -1,5 +1,21 @@
 /* See LICENSE.dwm file for copyright and license details. */
 
+/* Fixed size objects carved from cache line aligned slabs, freed objects
+ * are reused before a new slab is allocated. Slabs are only released by
+ * pooldestroy(), so memory use follows the peak instead of fragmenting. */
+typedef struct {
+	const char *name;
+	size_t size; /* of an object */
+	void *freelist; /* freed objects, linked through their first word */
+	void *slabs; /* linked through a pointer after their last object */
+	size_t live, peak, nslabs;
+} Pool;
+
 void die(const char *fmt, ...);
 void *ecalloc(size_t nmemb, size_t size);
 int fd_set_nonblock(int fd);
+void *poolalloc(Pool *p);
+size_t poolbytes(const Pool *p);
+void pooldestroy(Pool *p);
+void poolfree(Pool *p, void *ptr);
+unsigned int strhash(const char *s);